@@ -1,9 +1,99 @@
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#define ARGPARSE_DEFINE_GETTERS
 #include "argparse.h"
 
+#include <sys/stat.h>
+#include <unistd.h>
+#ifndef ARGPARSE_NO_THREADS
+#include <pthread.h>
+#endif
+
+// The _POSIX_C_SOURCE above has no effect once a system header was included
+// earlier in the translation unit, which argparse_single.h cannot prevent.
+#if defined(ARGPARSE_STATS) && !defined(CLOCK_MONOTONIC)
+#error "argparse: define _POSIX_C_SOURCE 200809L or include argparse before any system header"
+#endif
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
 const int INITIAL_BUFFER_SIZE = 256;
 const int PADDING = 2;
 const int FIRST_COLUMN_SIZE = 24;
 
+// Used as array bounds, which a const int is not in C.
+enum {
+    PATH_THREADS = 4,
+    PATH_CHECKS_PER_THREAD = 16,
+};
+
+#ifdef ARGPARSE_STATS
+#define PARSER_STATS_ADD(parser, field, count) ((parser)->stats.field += (count))
+#define PARSER_PHASE_ENTER(parser, phase) parser_phase_t prev_phase = _parser_phase_switch((parser), (phase))
+#define PARSER_PHASE_SWITCH(parser, phase) _parser_phase_switch((parser), (phase))
+#define PARSER_PHASE_LEAVE(parser) _parser_phase_switch((parser), prev_phase)
+#else
+#define PARSER_STATS_ADD(parser, field, count) ((void)0)
+#define PARSER_PHASE_ENTER(parser, phase) ((void)0)
+#define PARSER_PHASE_SWITCH(parser, phase) ((void)0)
+#define PARSER_PHASE_LEAVE(parser) ((void)0)
+#endif
+
+#define PARSER_MALLOC(parser, size) \
+    (PARSER_STATS_ADD(parser, allocations, 1), \
+     PARSER_STATS_ADD(parser, allocated_bytes, (size)), \
+     malloc(size))
+
+#ifdef ARGPARSE_STATS
+#if defined(__GNUC__)
+#define PARSER_NOINLINE __attribute__((noinline))
+#define PARSER_COMPILER_BARRIER() __asm__ volatile("" ::: "memory")
+#else
+#define PARSER_NOINLINE
+#define PARSER_COMPILER_BARRIER() ((void)0)
+#endif
+
+PARSER_NOINLINE void parser_trace_phase_begin(parser_phase_t phase) {
+    (void)phase;
+    PARSER_COMPILER_BARRIER();
+}
+
+PARSER_NOINLINE void parser_trace_phase_end(parser_phase_t phase) {
+    (void)phase;
+    PARSER_COMPILER_BARRIER();
+}
+
+unsigned long long _parser_now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+}
+
+parser_phase_t _parser_phase_switch(parser_t* parser, parser_phase_t phase) {
+    parser_phase_t prev = parser->stats.current_phase;
+    if (prev == phase) {
+        return prev;
+    }
+
+    unsigned long long now = _parser_now_ns();
+    if (prev != PARSER_PHASE_COUNT) {
+        parser->stats.phase_ns[prev] += now - parser->stats.phase_started_ns;
+        parser_trace_phase_end(prev);
+    }
+    if (phase != PARSER_PHASE_COUNT) {
+        parser_trace_phase_begin(phase);
+    }
+
+    parser->stats.current_phase = phase;
+    parser->stats.phase_started_ns = now;
+    return prev;
+}
+#endif
+
 bool _parser_prefix(const char *pre, const char *str)
 {
     return strncmp(pre, str, strlen(pre)) == 0;
@@ -23,6 +113,9 @@ void _parser_free_list(parser_base_arg_t** list) {
 
     while (prev != NULL) {
         next = (parser_base_arg_t*)prev->next;
+        if (prev->free_value != NULL) {
+            prev->free_value(prev);
+        }
         free(prev);
         prev = next;
     }
@@ -31,6 +124,7 @@ void _parser_free_list(parser_base_arg_t** list) {
 }
 
 void _parser_clear_last_err(parser_t* parser) {
+    parser->unrecognized = NULL;
     if (parser->last_err != NULL) {
         parser->last_err_pos = 0;
         parser->last_err[parser->last_err_pos] = '\0';
@@ -41,7 +135,7 @@ int _parser_append_last_err(parser_t* parser, char const * format, ...) {
     if (parser->last_err == NULL) {
         parser->last_err_pos = 0;
         parser->last_err_size = INITIAL_BUFFER_SIZE;
-        parser->last_err = (char*)malloc(sizeof(char) * parser->last_err_size);
+        parser->last_err = (char*)PARSER_MALLOC(parser, sizeof(char) * parser->last_err_size);
         parser->last_err[parser->last_err_pos] = '\0';
     }
 
@@ -64,7 +158,8 @@ int _parser_append_last_err(parser_t* parser, char const * format, ...) {
             }
 
             char* old_buf = parser->last_err;
-            parser->last_err = (char*)malloc(sizeof(char) * parser->last_err_size);
+            PARSER_STATS_ADD(parser, last_err_grows, 1);
+            parser->last_err = (char*)PARSER_MALLOC(parser, sizeof(char) * parser->last_err_size);
             memcpy(parser->last_err, old_buf, parser->last_err_pos);
             parser->last_err[parser->last_err_pos] = '\0';
             free(old_buf);
@@ -114,6 +209,7 @@ void _parser_append_usage_message(parser_t* parser) {
 }
 
 void _parser_set_positional_error_message(parser_t* parser, parser_base_arg_t* current_positional) {
+    PARSER_PHASE_ENTER(parser, PARSER_PHASE_RENDERING);
     _parser_clear_last_err(parser);
     _parser_append_usage_message(parser);
     _parser_append_last_err(parser, "%s: error: the following arguments are required:", parser->argv[0]);
@@ -125,12 +221,274 @@ void _parser_set_positional_error_message(parser_t* parser, parser_base_arg_t* c
         current_positional = (parser_base_arg_t*)current_positional->next;
     }
     _parser_append_last_err(parser, "\n");
+    PARSER_PHASE_LEAVE(parser);
 }
 
 void _parser_set_optional_error_message(parser_t* parser, char* argv) {
+    PARSER_PHASE_ENTER(parser, PARSER_PHASE_RENDERING);
     _parser_clear_last_err(parser);
     _parser_append_usage_message(parser);
     _parser_append_last_err(parser, "%s: error: unrecognized arguments: %s\n", parser->argv[0], argv);
+    parser->unrecognized = argv;
+    PARSER_PHASE_LEAVE(parser);
+}
+
+void _parser_free_suggest_index(parser_t* parser) {
+    free(parser->suggest_names);
+    free(parser->suggest_masks);
+    free(parser->suggest_lcps);
+    free(parser->suggest_offsets);
+    parser->suggest_names = NULL;
+    parser->suggest_masks = NULL;
+    parser->suggest_lcps = NULL;
+    parser->suggest_offsets = NULL;
+    parser->suggest_max_length = 0;
+}
+
+// Names are compared without their "-" / "--" prefix, otherwise the prefix
+// alone makes every short option look close to every other one.
+char const * _parser_strip_dashes(char const * name) {
+    return _parser_prefix("--", name) ? name + 2 : _parser_prefix("-", name) ? name + 1 : name;
+}
+
+int _parser_suggest_compare(const void* left, const void* right) {
+    return strcmp(_parser_strip_dashes(*(char const * const *)left), _parser_strip_dashes(*(char const * const *)right));
+}
+
+unsigned long long _parser_char_mask(char const * value) {
+    unsigned long long mask = 0;
+    while (*value != '\0') {
+        mask |= 1ULL << ((unsigned char)*value & 63);
+        value++;
+    }
+    return mask;
+}
+
+int _parser_popcount(unsigned long long value) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(value);
+#else
+    int count = 0;
+    while (value != 0) {
+        value &= value - 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+parser_result_t _parser_build_suggest_index(parser_t* parser) {
+    int count = 0;
+    for (parser_base_arg_t* current = parser->optional_args; current != NULL; current = current->next) {
+        count += (current->keyword != NULL) + (current->keyshort != NULL);
+    }
+
+    char const ** names = (char const **)PARSER_MALLOC(parser, sizeof(char const *) * (count + 1));
+    int* lengths = (int*)PARSER_MALLOC(parser, sizeof(int) * (count + 1));
+    if (names == NULL || lengths == NULL) {
+        free(names);
+        free(lengths);
+        return PARSER_RESULT_ERROR;
+    }
+
+    int max_length = 0;
+    count = 0;
+    for (parser_base_arg_t* current = parser->optional_args; current != NULL; current = current->next) {
+        char const * keys[] = { current->keyword, current->keyshort };
+        for (int i = 0; i < 2; ++i) {
+            if (keys[i] != NULL) {
+                names[count] = keys[i];
+                lengths[count] = (int)strlen(_parser_strip_dashes(keys[i]));
+                max_length = lengths[count] > max_length ? lengths[count] : max_length;
+                count++;
+            }
+        }
+    }
+
+    parser->suggest_names = (char const **)PARSER_MALLOC(parser, sizeof(char const *) * (count + 1));
+    parser->suggest_masks = (unsigned long long*)PARSER_MALLOC(parser, sizeof(unsigned long long) * (count + 1));
+    parser->suggest_lcps = (unsigned char*)PARSER_MALLOC(parser, sizeof(unsigned char) * (count + 1));
+    parser->suggest_offsets = (int*)PARSER_MALLOC(parser, sizeof(int) * (max_length + 2));
+    if (parser->suggest_names == NULL || parser->suggest_masks == NULL ||
+        parser->suggest_lcps == NULL || parser->suggest_offsets == NULL) {
+        _parser_free_suggest_index(parser);
+        free(names);
+        free(lengths);
+        return PARSER_RESULT_ERROR;
+    }
+    parser->suggest_max_length = max_length;
+
+    memset(parser->suggest_offsets, 0, sizeof(int) * (max_length + 2));
+    for (int i = 0; i < count; ++i) {
+        parser->suggest_offsets[lengths[i] + 1]++;
+    }
+    for (int i = 1; i <= max_length + 1; ++i) {
+        parser->suggest_offsets[i] += parser->suggest_offsets[i - 1];
+    }
+
+    // Scatter by length, then restore the offsets shifted by the scatter.
+    for (int i = 0; i < count; ++i) {
+        parser->suggest_names[parser->suggest_offsets[lengths[i]]++] = names[i];
+    }
+    for (int i = max_length; i > 0; --i) {
+        parser->suggest_offsets[i] = parser->suggest_offsets[i - 1];
+    }
+    parser->suggest_offsets[0] = 0;
+
+    // Each bucket is sorted, so the names sharing a prefix are adjacent and
+    // the common prefix length with the previous name tells how much of the
+    // edit distance computation can be reused.
+    for (int length = 0; length <= max_length; ++length) {
+        int begin = parser->suggest_offsets[length];
+        int end = parser->suggest_offsets[length + 1];
+        qsort(&parser->suggest_names[begin], end - begin, sizeof(char const *), _parser_suggest_compare);
+
+        char const * previous = "";
+        for (int i = begin; i < end; ++i) {
+            char const * name = _parser_strip_dashes(parser->suggest_names[i]);
+            int lcp = 0;
+            while (lcp < UCHAR_MAX && name[lcp] != '\0' && name[lcp] == previous[lcp]) {
+                lcp++;
+            }
+            parser->suggest_masks[i] = _parser_char_mask(name);
+            parser->suggest_lcps[i] = (unsigned char)lcp;
+            previous = name;
+        }
+    }
+
+    free(names);
+    free(lengths);
+    return PARSER_RESULT_OK;
+}
+
+typedef struct _parser_edit_state_t {
+    unsigned long long pv;
+    unsigned long long mv;
+    int score;
+} _parser_edit_state_t;
+
+// One text column of the bit-parallel (Myers/Hyyro) edit distance, the
+// pattern is described by its match vectors and last marks its final bit.
+void _parser_edit_step(_parser_edit_state_t const * from, _parser_edit_state_t* to,
+                       unsigned long long eq, unsigned long long last) {
+    unsigned long long xv = eq | from->mv;
+    unsigned long long xh = (((eq & from->pv) + from->pv) ^ from->pv) | eq;
+    unsigned long long ph = from->mv | ~(xh | from->pv);
+    unsigned long long mh = from->pv & xh;
+
+    to->score = from->score + ((ph & last) != 0) - ((mh & last) != 0);
+    ph = (ph << 1) | 1;
+    mh = mh << 1;
+    to->pv = mh | ~(xv | ph);
+    to->mv = ph & xv;
+}
+
+void _parser_append_suggestions(parser_t* parser) {
+    PARSER_PHASE_ENTER(parser, PARSER_PHASE_RENDERING);
+    char const * token = _parser_strip_dashes(parser->unrecognized);
+    int length = (int)strlen(token);
+    parser->unrecognized = NULL;
+
+    if (length == 0 || length > 64 ||
+        (parser->suggest_names == NULL && _parser_build_suggest_index(parser) != PARSER_RESULT_OK)) {
+        PARSER_PHASE_LEAVE(parser);
+        return;
+    }
+
+    unsigned long long peq[256];
+    memset(peq, 0, sizeof(peq));
+    for (int i = 0; i < length; ++i) {
+        peq[(unsigned char)token[i]] |= 1ULL << i;
+    }
+    unsigned long long last = 1ULL << (length - 1);
+    unsigned long long token_mask = _parser_char_mask(token);
+
+    // states[j] holds the distance state after the first j characters of the
+    // current name, names are never longer than length + limit.
+    _parser_edit_state_t states[64 + 64 / 4 + 2];
+    states[0].pv = ~0ULL;
+    states[0].mv = 0;
+    states[0].score = length;
+
+    // Length buckets are visited nearest first, so the limit shrinks before
+    // the wider buckets are reached. Characters missing on either side give
+    // a cheap lower bound which skips unrelated names, while names sharing a
+    // prefix resume from the state of their common prefix and are skipped
+    // together once that prefix cannot get back under the limit. A suggestion
+    // has to keep at least one character of the token.
+    char const * best[3];
+    int best_count = 0;
+    int limit = length / 4 + 1 < length - 1 ? length / 4 + 1 : length - 1;
+    for (int delta = 0; delta <= limit; ++delta) {
+        for (int side = 0; side < (delta == 0 ? 1 : 2); ++side) {
+            int current_length = side == 0 ? length - delta : length + delta;
+            if (current_length < 1 || current_length > parser->suggest_max_length) {
+                continue;
+            }
+
+            int depth = 0;
+            int end = parser->suggest_offsets[current_length + 1];
+            for (int i = parser->suggest_offsets[current_length]; i < end; ++i) {
+                depth = parser->suggest_lcps[i] < depth ? parser->suggest_lcps[i] : depth;
+
+                unsigned long long mask = parser->suggest_masks[i];
+                int missing = _parser_popcount(token_mask & ~mask);
+                int extra = _parser_popcount(mask & ~token_mask);
+                if (missing > limit || extra > limit) {
+                    continue;
+                }
+
+                // Every character left in the name moves the score by at most one.
+                char const * name = _parser_strip_dashes(parser->suggest_names[i]);
+                while (depth < current_length && states[depth].score - (current_length - depth) <= limit) {
+                    _parser_edit_step(&states[depth], &states[depth + 1], peq[(unsigned char)name[depth]], last);
+                    depth++;
+                }
+
+                int distance = states[depth].score - (current_length - depth);
+                if (distance > limit) {
+                    while (i + 1 < end && parser->suggest_lcps[i + 1] >= depth) {
+                        i++;
+                    }
+                    continue;
+                }
+
+                if (distance < limit) {
+                    limit = distance;
+                    best_count = 0;
+                }
+                if (best_count < 3) {
+                    best[best_count++] = parser->suggest_names[i];
+                }
+            }
+        }
+    }
+
+    if (best_count > 0 && parser->last_err_pos > 0) {
+        parser->last_err[--parser->last_err_pos] = '\0';
+        _parser_append_last_err(parser, ", maybe you meant");
+        for (int i = 0; i < best_count; ++i) {
+            _parser_append_last_err(parser, i == 0 ? " '%s'" : " or '%s'", best[i]);
+        }
+        _parser_append_last_err(parser, "?\n");
+    }
+    PARSER_PHASE_LEAVE(parser);
+}
+
+void _parser_append_arg_name(parser_t* parser, parser_base_arg_t* element) {
+    if (element->keyshort != NULL && element->keyword != NULL) {
+        _parser_append_last_err(parser, "%s/%s", element->keyshort, element->keyword);
+    } else {
+        _parser_append_last_err(parser, "%s", element->keyshort != NULL ? element->keyshort : element->keyword);
+    }
+}
+
+void _parser_begin_arg_error_message(parser_t* parser, parser_base_arg_t* element) {
+    _parser_clear_last_err(parser);
+    _parser_append_usage_message(parser);
+    _parser_append_last_err(parser, "%s: error: argument ", parser->argv[0]);
+    _parser_append_arg_name(parser, element);
+    _parser_append_last_err(parser, ": ");
 }
 
 void _parser_append_arg_help(parser_t* parser, int offset, parser_base_arg_t* arg) {
@@ -150,6 +508,7 @@ void _parser_append_arg_help(parser_t* parser, int offset, parser_base_arg_t* ar
 }
 
 void _parser_set_help_message(parser_t* parser) {
+    PARSER_PHASE_ENTER(parser, PARSER_PHASE_RENDERING);
     _parser_clear_last_err(parser);
     _parser_append_usage_message(parser);
     _parser_append_last_err(parser, "\n");
@@ -198,9 +557,19 @@ void _parser_set_help_message(parser_t* parser) {
         }
         _parser_append_last_err(parser, "\n");
     }
+    PARSER_PHASE_LEAVE(parser);
 }
 
 void _parser_set_alt(parser_base_arg_t* element, char const * keyword) {
+    // A renamed option invalidates the suggestion index, while names of an
+    // attached parser are fixed by its image index.
+    if (element->parser != NULL) {
+        if (element->parser->image != NULL) {
+            return;
+        }
+        _parser_free_suggest_index(element->parser);
+    }
+
     if (_parser_prefix("-", keyword) && !_parser_prefix("--", keyword)) {
         element->keyshort = keyword;
     } else {
@@ -212,27 +581,90 @@ bool _parser_is_filled(parser_base_arg_t* element) {
     return element->is_filled;
 }
 
+// A lazily recorded token still reads the default until it converts, so the
+// value slot has to follow set_default until then (and after a failure).
+bool _parser_holds_default(parser_base_arg_t* element) {
+#ifdef ARGPARSE_LAZY
+    if (element->is_pending || element->is_invalid) {
+        return true;
+    }
+#endif
+    return !element->is_filled;
+}
+
 void _parser_set_help(parser_base_arg_t* element, char const * help) {
     element->help = help;
 }
 
-void _parser_add_arg(parser_t* parser,
-                     parser_base_arg_t* element,
-                     char const * keyword,
-                     void (*set_value)(void*, char const *)) {
+void _parser_set_action(parser_base_arg_t* element, parser_action_t action, void* context) {
+    element->action = action;
+    element->action_context = context;
+}
+
+void _parser_init_arg(parser_base_arg_t* element,
+                      parser_result_t (*set_value)(parser_t*, void*, char const *)) {
     element->keyshort = NULL;
     element->keyword = NULL;
     element->help = NULL;
     element->next = NULL;
+    element->parser = NULL;
     element->is_filled = false;
     element->set_value = set_value;
+    element->free_value = NULL;
+    element->action = NULL;
+    element->action_context = NULL;
+#ifdef ARGPARSE_LAZY
+    element->raw_value = NULL;
+    element->is_pending = false;
+    element->is_invalid = false;
+#endif
+}
 
+void _parser_add_arg(parser_t* parser,
+                     parser_base_arg_t* element,
+                     char const * keyword,
+                     parser_result_t (*set_value)(parser_t*, void*, char const *)) {
+    PARSER_PHASE_ENTER(parser, PARSER_PHASE_REGISTRATION);
+    _parser_init_arg(element, set_value);
+    element->parser = parser;
     _parser_set_alt(element, keyword);
     if (_parser_prefix("--", keyword) || _parser_prefix("-", keyword)) {
         _parser_append_list(&parser->optional_args, element);
     } else {
         _parser_append_list(&parser->positional_args, element);
     }
+    PARSER_PHASE_LEAVE(parser);
+}
+
+void _parser_init_parser(parser_t* parser) {
+    parser->argc = 0;
+    parser->argv = NULL;
+    parser->last_err = NULL;
+    parser->last_err_pos = 0;
+    parser->last_err_size = 0;
+    parser->help_arg = NULL;
+    parser->optional_args = NULL;
+    parser->positional_args = NULL;
+    parser->path_args = NULL;
+    parser->unrecognized = NULL;
+    parser->suggest_names = NULL;
+    parser->suggest_masks = NULL;
+    parser->suggest_lcps = NULL;
+    parser->suggest_offsets = NULL;
+    parser->suggest_max_length = 0;
+    parser->image = NULL;
+    parser->image_args = NULL;
+    parser->image_index = NULL;
+    parser->image_index_mask = 0;
+
+#ifdef ARGPARSE_LAZY
+    parser->is_lazy = false;
+#endif
+
+#ifdef ARGPARSE_STATS
+    memset(&parser->stats, 0, sizeof(parser->stats));
+    parser->stats.current_phase = PARSER_PHASE_COUNT;
+#endif
 }
 
 parser_result_t parser_init(parser_t** parser) {
@@ -246,12 +678,13 @@ parser_result_t parser_init(parser_t** parser) {
         return PARSER_RESULT_ERROR;
     }
 
-    temp->last_err = NULL;
-    temp->last_err_pos = 0;
-    temp->last_err_size = 0;
+    _parser_init_parser(temp);
     temp->help_arg = help_arg;
-    temp->optional_args = NULL;
-    temp->positional_args = NULL;
+
+#ifdef ARGPARSE_STATS
+    PARSER_STATS_ADD(temp, allocations, 2);
+    PARSER_STATS_ADD(temp, allocated_bytes, sizeof(parser_t) + sizeof(parser_flag_arg_t));
+#endif
 
     _parser_add_arg(temp, (parser_base_arg_t*)help_arg, "--help", NULL);
     _parser_set_alt((parser_base_arg_t*)help_arg, "-h");
@@ -267,8 +700,12 @@ parser_result_t parser_free(parser_t** parser) {
         return PARSER_RESULT_ERROR;
     }
 
-    _parser_free_list(&temp->positional_args);
-    _parser_free_list(&temp->optional_args);
+    // An attached parser owns its args as part of its own allocation.
+    if (temp->image == NULL) {
+        _parser_free_list(&temp->positional_args);
+        _parser_free_list(&temp->optional_args);
+    }
+    _parser_free_suggest_index(temp);
     if (temp->last_err != NULL) {
         free(temp->last_err);
     }
@@ -278,7 +715,77 @@ parser_result_t parser_free(parser_t** parser) {
     return PARSER_RESULT_OK;
 }
 
+parser_result_t _parser_accept_arg(parser_t* parser, parser_base_arg_t* element, char const * value) {
+#ifdef ARGPARSE_LAZY
+    if (parser->is_lazy && element->set_value != NULL) {
+        element->raw_value = value;
+        element->is_pending = true;
+        element->is_invalid = false;
+    } else
+#endif
+    if (element->set_value != NULL) {
+        parser_result_t result = element->set_value(parser, element, value);
+        if (result != PARSER_RESULT_OK) {
+            return result;
+        }
+    }
+    element->is_filled = true;
+
+    if (element->action != NULL) {
+        _parser_clear_last_err(parser);
+        parser_result_t result = element->action(parser, element, element->action_context);
+        if (result == PARSER_RESULT_ERROR && (parser->last_err == NULL || parser->last_err[0] == '\0')) {
+            PARSER_PHASE_ENTER(parser, PARSER_PHASE_RENDERING);
+            _parser_begin_arg_error_message(parser, element);
+            if (value != NULL) {
+                _parser_append_last_err(parser, "invalid value: '%s'\n", value);
+            } else {
+                _parser_append_last_err(parser, "not allowed\n");
+            }
+            PARSER_PHASE_LEAVE(parser);
+        }
+        return result;
+    }
+    return PARSER_RESULT_OK;
+}
+
+parser_result_t _parser_check_paths(parser_t* parser);
+parser_base_arg_t* _parser_image_find_optional(parser_t* parser, char const * name);
+
+parser_base_arg_t* _parser_find_optional(parser_t* parser, char const * name) {
+    PARSER_STATS_ADD(parser, lookups, 1);
+    if (parser->image != NULL) {
+        return _parser_image_find_optional(parser, name);
+    }
+
+    bool is_long = _parser_prefix("--", name);
+    parser_base_arg_t* current = parser->optional_args;
+    while (current != NULL) {
+        char const * key = is_long ? current->keyword : current->keyshort;
+        PARSER_STATS_ADD(parser, lookup_comparisons, key != NULL);
+        if (key != NULL && strcmp(key, name) == 0) {
+            return current;
+        }
+        current = (parser_base_arg_t*)current->next;
+    }
+    return NULL;
+}
+
+parser_base_arg_t* parser_find_arg(parser_t* parser, char const * name) {
+    if (_parser_prefix("-", name)) {
+        return _parser_find_optional(parser, name);
+    }
+
+    parser_base_arg_t* current = parser->positional_args;
+    while (current != NULL && strcmp(current->keyword, name) != 0) {
+        current = (parser_base_arg_t*)current->next;
+    }
+    return current;
+}
+
 parser_result_t parser_parse(parser_t* parser, int argc, char** argv) {
+    PARSER_PHASE_ENTER(parser, PARSER_PHASE_PARSE);
+    parser_result_t result = PARSER_RESULT_OK;
     parser_base_arg_t* current_optional = NULL;
     parser_base_arg_t* current_positional = parser->positional_args;
 
@@ -286,75 +793,133 @@ parser_result_t parser_parse(parser_t* parser, int argc, char** argv) {
     parser->argv = argv;
 
     for (int i=1; i < argc; ++i) {
+        PARSER_STATS_ADD(parser, tokens, 1);
         if (current_optional != NULL) {
-            if (current_optional->set_value != NULL) {
-                current_optional->set_value(current_optional, argv[i]);
-            }
-            current_optional->is_filled = true;
+            result = _parser_accept_arg(parser, current_optional, argv[i]);
             current_optional = NULL;
+            if (result != PARSER_RESULT_OK) {
+                break;
+            }
             continue;
         }
 
         if (strcmp(argv[i], "-") != 0 && _parser_prefix("-", argv[i])) {
-            if (_parser_prefix("--", argv[i])) {
-                current_optional = parser->optional_args;
-                while (current_optional != NULL) {
-                    if (current_optional->keyword != NULL && strcmp(current_optional->keyword, argv[i]) == 0) {
-                        break;
-                    }
-                    current_optional = (parser_base_arg_t*)current_optional->next;
-                }
-            } else {
-                current_optional = parser->optional_args;
-                while (current_optional != NULL) {
-                    if (current_optional->keyshort != NULL && strcmp(current_optional->keyshort, argv[i]) == 0) {
-                        break;
-                    }
-                    current_optional = (parser_base_arg_t*)current_optional->next;
-                }
-            }
+            current_optional = _parser_find_optional(parser, argv[i]);
 
             if (current_optional == NULL) {
                 _parser_set_optional_error_message(parser, argv[i]);
-                return PARSER_RESULT_ERROR;
+                result = PARSER_RESULT_ERROR;
+                break;
             }
 
             if (current_optional->set_value == NULL) {
-                current_optional->is_filled = true;
+                result = _parser_accept_arg(parser, current_optional, NULL);
                 current_optional = NULL;
+                if (result != PARSER_RESULT_OK) {
+                    break;
+                }
             }
 
             continue;
         }
 
         if (current_positional != NULL) {
-            current_positional->set_value(current_positional, argv[i]);
-            current_positional->is_filled = true;
+            result = _parser_accept_arg(parser, current_positional, argv[i]);
             current_positional = (parser_base_arg_t*)current_positional->next;
+            if (result != PARSER_RESULT_OK) {
+                break;
+            }
+        }
+    }
+
+    // Path args filled before the stop may already have been handed off by
+    // their actions, so they are still checked.
+    if (result == PARSER_RESULT_STOP) {
+        PARSER_PHASE_SWITCH(parser, PARSER_PHASE_VALIDATION);
+        if (_parser_check_paths(parser) != PARSER_RESULT_OK) {
+            result = PARSER_RESULT_ERROR;
         }
     }
 
+    if (result != PARSER_RESULT_OK) {
+        PARSER_PHASE_LEAVE(parser);
+        return result;
+    }
+
+    PARSER_PHASE_SWITCH(parser, PARSER_PHASE_VALIDATION);
+
     if (_parser_is_filled((parser_base_arg_t*)parser->help_arg)) {
         _parser_set_help_message(parser);
+        PARSER_PHASE_LEAVE(parser);
         return PARSER_RESULT_HELP;
     }
 
     if (current_positional != NULL) {
         _parser_set_positional_error_message(parser, current_positional);
+        PARSER_PHASE_LEAVE(parser);
         return PARSER_RESULT_ERROR;
     }
 
-    return PARSER_RESULT_OK;
+    result = _parser_check_paths(parser);
+    PARSER_PHASE_LEAVE(parser);
+    return result;
 }
 
 const char* parser_get_last_err(parser_t* parser) {
+    if (parser->unrecognized != NULL) {
+        _parser_append_suggestions(parser);
+    }
     return parser->last_err;
 }
 
+void parser_set_arg_error(parser_t* parser, void* arg, char const * message) {
+    PARSER_PHASE_ENTER(parser, PARSER_PHASE_RENDERING);
+    _parser_begin_arg_error_message(parser, (parser_base_arg_t*)arg);
+    _parser_append_last_err(parser, "%s\n", message);
+    PARSER_PHASE_LEAVE(parser);
+}
+
+#ifdef ARGPARSE_LAZY
+void parser_set_lazy(parser_t* parser, bool is_lazy) {
+    parser->is_lazy = is_lazy;
+}
+
+parser_result_t _parser_convert_value(parser_t* parser, parser_base_arg_t* element) {
+    parser_result_t result = element->set_value(parser, element, element->raw_value);
+    element->is_pending = false;
+    element->is_invalid = result != PARSER_RESULT_OK;
+    return result;
+}
+#endif
+
+parser_result_t _parser_check_value(parser_t* parser, parser_base_arg_t* element) {
+#ifdef ARGPARSE_LAZY
+    if (element->is_pending || element->is_invalid) {
+        return _parser_convert_value(parser, element);
+    }
+#endif
+    return PARSER_RESULT_OK;
+}
+
+#ifdef ARGPARSE_STATS
+parser_result_t parser_get_stats(parser_t* parser, parser_stats_t* stats) {
+    if (parser == NULL || stats == NULL) {
+        return PARSER_RESULT_ERROR;
+    }
+
+    *stats = parser->stats;
+    return PARSER_RESULT_OK;
+}
+#endif
+
 
 
 parser_result_t parser_flag_add_arg(parser_t* parser, parser_flag_arg_t** arg, char const * keyword) {
-    parser_flag_arg_t* temp = (parser_flag_arg_t*)malloc(sizeof(parser_flag_arg_t));
+    if (parser->image != NULL) {
+        return PARSER_RESULT_ERROR;
+    }
+
+    parser_flag_arg_t* temp = (parser_flag_arg_t*)PARSER_MALLOC(parser, sizeof(parser_flag_arg_t));
     if (temp == NULL) {
         return PARSER_RESULT_ERROR;
     }
@@ -365,10 +930,6 @@ parser_result_t parser_flag_add_arg(parser_t* parser, parser_flag_arg_t** arg, c
     return PARSER_RESULT_OK;
 }
 
-bool parser_flag_is_filled(parser_flag_arg_t* arg) {
-    return _parser_is_filled((parser_base_arg_t*)arg);
-}
-
 void parser_flag_set_alt(parser_flag_arg_t* arg, char const * alt) {
     _parser_set_alt((parser_base_arg_t*)arg, alt);
 }
@@ -377,15 +938,36 @@ void parser_flag_set_help(parser_flag_arg_t* arg, char const * help) {
     _parser_set_help((parser_base_arg_t*)arg, help);
 }
 
+void parser_flag_set_action(parser_flag_arg_t* arg, parser_action_t action, void* context) {
+    _parser_set_action((parser_base_arg_t*)arg, action, context);
+}
+
 
 
-void _parser_set_int_value(void* element, char const * value) {
+parser_result_t _parser_set_int_value(parser_t* parser, void* element, char const * value) {
     char* end_ptr;
-    ((parser_int_arg_t*)element)->value = strtol(value, &end_ptr, 10);
+    errno = 0;
+    long result = strtol(value, &end_ptr, 10);
+    if (end_ptr != value && *end_ptr == '\0' && errno == 0 && result >= INT_MIN && result <= INT_MAX) {
+        ((parser_int_arg_t*)element)->value = (int)result;
+        return PARSER_RESULT_OK;
+    }
+
+    if (parser != NULL) {
+        PARSER_PHASE_ENTER(parser, PARSER_PHASE_RENDERING);
+        _parser_begin_arg_error_message(parser, (parser_base_arg_t*)element);
+        _parser_append_last_err(parser, "invalid int value: '%s'\n", value);
+        PARSER_PHASE_LEAVE(parser);
+    }
+    return PARSER_RESULT_ERROR;
 }
 
 parser_result_t parser_int_add_arg(parser_t* parser, parser_int_arg_t** arg, char const * keyword) {
-    parser_int_arg_t* temp = (parser_int_arg_t*)malloc(sizeof(parser_int_arg_t));
+    if (parser->image != NULL) {
+        return PARSER_RESULT_ERROR;
+    }
+
+    parser_int_arg_t* temp = (parser_int_arg_t*)PARSER_MALLOC(parser, sizeof(parser_int_arg_t));
     if (temp == NULL) {
         return PARSER_RESULT_ERROR;
     }
@@ -398,15 +980,10 @@ parser_result_t parser_int_add_arg(parser_t* parser, parser_int_arg_t** arg, cha
     return PARSER_RESULT_OK;
 }
 
-int parser_int_get_value(parser_int_arg_t* arg) {
-    if (_parser_is_filled((parser_base_arg_t*)arg)) {
-        return arg->value;
-    }
-    return arg->default_value;
-}
-
-bool parser_int_is_filled(parser_int_arg_t* arg) {
-    return _parser_is_filled((parser_base_arg_t*)arg);
+parser_result_t parser_int_get_checked(parser_t* parser, parser_int_arg_t* arg, int* value) {
+    parser_result_t result = _parser_check_value(parser, (parser_base_arg_t*)arg);
+    *value = arg->value;
+    return result;
 }
 
 void parser_int_set_alt(parser_int_arg_t* arg, char const * alt) {
@@ -417,18 +994,30 @@ void parser_int_set_help(parser_int_arg_t* arg, char const * help) {
     _parser_set_help((parser_base_arg_t*)arg, help);
 }
 
+void parser_int_set_action(parser_int_arg_t* arg, parser_action_t action, void* context) {
+    _parser_set_action((parser_base_arg_t*)arg, action, context);
+}
+
 void parser_int_set_default(parser_int_arg_t* arg, int default_value) {
     arg->default_value = default_value;
+    if (_parser_holds_default((parser_base_arg_t*)arg)) {
+        arg->value = default_value;
+    }
 }
 
 
 
-void _parser_set_string_value(void* element, char const * value) {
+parser_result_t _parser_set_string_value(parser_t* parser, void* element, char const * value) {
     ((parser_string_arg_t*)element)->value = value;
+    return PARSER_RESULT_OK;
 }
 
 parser_result_t parser_string_add_arg(parser_t* parser, parser_string_arg_t** arg, char const * keyword) {
-    parser_string_arg_t* temp = (parser_string_arg_t*)malloc(sizeof(parser_string_arg_t));
+    if (parser->image != NULL) {
+        return PARSER_RESULT_ERROR;
+    }
+
+    parser_string_arg_t* temp = (parser_string_arg_t*)PARSER_MALLOC(parser, sizeof(parser_string_arg_t));
     if (temp == NULL) {
         return PARSER_RESULT_ERROR;
     }
@@ -441,25 +1030,993 @@ parser_result_t parser_string_add_arg(parser_t* parser, parser_string_arg_t** ar
     return PARSER_RESULT_OK;
 }
 
-const char* parser_string_get_value(parser_string_arg_t* arg) {
-    if (_parser_is_filled((parser_base_arg_t*)arg)) {
-        return arg->value;
+void parser_string_set_alt(parser_string_arg_t* arg, char const * alt) {
+    _parser_set_alt((parser_base_arg_t*)arg, alt);
+}
+
+void parser_string_set_help(parser_string_arg_t* arg, char const * help) {
+    _parser_set_help((parser_base_arg_t*)arg, help);
+}
+
+void parser_string_set_action(parser_string_arg_t* arg, parser_action_t action, void* context) {
+    _parser_set_action((parser_base_arg_t*)arg, action, context);
+}
+
+void parser_string_set_default(parser_string_arg_t* arg, char const * default_value) {
+    arg->default_value = default_value;
+    if (_parser_holds_default((parser_base_arg_t*)arg)) {
+        arg->value = default_value;
     }
-    return arg->default_value;
 }
 
-bool parser_string_is_filled(parser_string_arg_t* arg) {
-    return _parser_is_filled((parser_base_arg_t*)arg);
+
+
+enum {
+    // Seeds tried per bucket before the whole table is rebuilt with another
+    // primary salt, and the number of such rebuilds before giving up.
+    CHOICE_SEED_LIMIT = 1 << 12,
+    CHOICE_SALT_LIMIT = 8,
+};
+
+typedef struct _parser_choice_bucket_t {
+    int index;
+    int size;
+} _parser_choice_bucket_t;
+
+// FNV-1 over the value followed by the murmur3 finalizer: the raw FNV state
+// is reduced modulo the table size, and for power-of-two sizes its low bits
+// depend only on the low bits of the seed and of each character.
+unsigned int _parser_hash(unsigned int seed, char const * value) {
+    unsigned int hash = 0x811c9dc5u ^ (seed * 0x9e3779b9u);
+    while (*value != '\0') {
+        hash = (hash * 0x01000193u) ^ (unsigned char)*value;
+        value++;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
 }
 
-void parser_string_set_alt(parser_string_arg_t* arg, char const * alt) {
+int _parser_choice_bucket_compare(const void* left, const void* right) {
+    return ((const _parser_choice_bucket_t*)right)->size - ((const _parser_choice_bucket_t*)left)->size;
+}
+
+bool _parser_choice_has_duplicates(parser_choice_arg_t* arg, int* keys, int size) {
+    for (int i = 0; i < size; ++i) {
+        for (int j = i + 1; j < size; ++j) {
+            if (strcmp(arg->choices[keys[i]], arg->choices[keys[j]]) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Places every bucket of size > 1 by searching a seed that sends its keys to
+// distinct free slots, single-key buckets are then put directly into the
+// remaining slots. Returns false when some bucket exhausts CHOICE_SEED_LIMIT.
+bool _parser_choice_place(parser_choice_arg_t* arg, _parser_choice_bucket_t* buckets,
+                          int* bucket_keys, int* bucket_offsets, int* candidate_slots) {
+    int count = arg->choices_count;
+    int bucket = 0;
+    int free_slot = 0;
+
+    for (; bucket < count && buckets[bucket].size > 1; ++bucket) {
+        int* keys = &bucket_keys[bucket_offsets[buckets[bucket].index]];
+        int size = buckets[bucket].size;
+
+        unsigned int seed = 1;
+        int placed = 0;
+        while (placed < size) {
+            for (placed = 0; placed < size; ++placed) {
+                int slot = (int)(_parser_hash(seed, arg->choices[keys[placed]]) % (unsigned int)count);
+                if (arg->slots[slot] != -1) {
+                    break;
+                }
+
+                int taken = 0;
+                for (int k = 0; k < placed; ++k) {
+                    if (candidate_slots[k] == slot) {
+                        taken = 1;
+                        break;
+                    }
+                }
+                if (taken) {
+                    break;
+                }
+                candidate_slots[placed] = slot;
+            }
+
+            if (placed < size && ++seed > CHOICE_SEED_LIMIT) {
+                return false;
+            }
+        }
+
+        arg->displacements[buckets[bucket].index] = (int)seed;
+        for (int i = 0; i < size; ++i) {
+            arg->slots[candidate_slots[i]] = keys[i];
+        }
+    }
+
+    for (; bucket < count && buckets[bucket].size == 1; ++bucket) {
+        while (arg->slots[free_slot] != -1) {
+            free_slot++;
+        }
+        arg->displacements[buckets[bucket].index] = -free_slot - 1;
+        arg->slots[free_slot] = bucket_keys[bucket_offsets[buckets[bucket].index]];
+    }
+
+    return true;
+}
+
+parser_result_t _parser_choice_build(parser_t* parser, parser_choice_arg_t* arg) {
+    int count = arg->choices_count;
+    parser_result_t result = PARSER_RESULT_ERROR;
+
+    arg->displacements = (int*)PARSER_MALLOC(parser, sizeof(int) * count);
+    arg->slots = (int*)PARSER_MALLOC(parser, sizeof(int) * count);
+    int* key_buckets = (int*)PARSER_MALLOC(parser, sizeof(int) * count);
+    int* bucket_keys = (int*)PARSER_MALLOC(parser, sizeof(int) * count);
+    int* bucket_offsets = (int*)PARSER_MALLOC(parser, sizeof(int) * (count + 1));
+    int* candidate_slots = (int*)PARSER_MALLOC(parser, sizeof(int) * count);
+    _parser_choice_bucket_t* buckets =
+        (_parser_choice_bucket_t*)PARSER_MALLOC(parser, sizeof(_parser_choice_bucket_t) * count);
+    if (arg->displacements == NULL || arg->slots == NULL || key_buckets == NULL || bucket_keys == NULL ||
+        bucket_offsets == NULL || candidate_slots == NULL || buckets == NULL) {
+        goto cleanup;
+    }
+
+    // Salts are kept above the seed range so the primary hash never matches
+    // the hash of a bucket seed.
+    for (int attempt = 0; attempt < CHOICE_SALT_LIMIT; ++attempt) {
+        arg->salt = attempt == 0 ? 0u : (unsigned int)(CHOICE_SEED_LIMIT + attempt);
+
+        for (int i = 0; i < count; ++i) {
+            arg->displacements[i] = 0;
+            arg->slots[i] = -1;
+            buckets[i].index = i;
+            buckets[i].size = 0;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            key_buckets[i] = (int)(_parser_hash(arg->salt, arg->choices[i]) % (unsigned int)count);
+            buckets[key_buckets[i]].size++;
+        }
+
+        bucket_offsets[0] = 0;
+        for (int i = 0; i < count; ++i) {
+            bucket_offsets[i + 1] = bucket_offsets[i] + buckets[i].size;
+        }
+        for (int i = 0; i < count; ++i) {
+            candidate_slots[i] = bucket_offsets[i];
+        }
+        for (int i = 0; i < count; ++i) {
+            bucket_keys[candidate_slots[key_buckets[i]]++] = i;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            if (buckets[i].size > 1 &&
+                _parser_choice_has_duplicates(arg, &bucket_keys[bucket_offsets[i]], buckets[i].size)) {
+                goto cleanup;
+            }
+        }
+
+        qsort(buckets, count, sizeof(_parser_choice_bucket_t), _parser_choice_bucket_compare);
+
+        if (_parser_choice_place(arg, buckets, bucket_keys, bucket_offsets, candidate_slots)) {
+            result = PARSER_RESULT_OK;
+            break;
+        }
+    }
+
+cleanup:
+    free(key_buckets);
+    free(bucket_keys);
+    free(bucket_offsets);
+    free(candidate_slots);
+    free(buckets);
+    return result;
+}
+
+void _parser_free_choice_value(void* element) {
+    parser_choice_arg_t* arg = (parser_choice_arg_t*)element;
+    free(arg->displacements);
+    free(arg->slots);
+}
+
+parser_result_t _parser_set_choice_value(parser_t* parser, void* element, char const * value) {
+    parser_choice_arg_t* arg = (parser_choice_arg_t*)element;
+    int id = parser_choice_lookup(arg, value);
+    if (id >= 0) {
+        arg->value = id;
+        return PARSER_RESULT_OK;
+    }
+
+    if (parser != NULL) {
+        PARSER_PHASE_ENTER(parser, PARSER_PHASE_RENDERING);
+        _parser_begin_arg_error_message(parser, (parser_base_arg_t*)arg);
+        _parser_append_last_err(parser, "invalid choice: '%s' (choose from", value);
+        for (int i = 0; i < arg->choices_count; ++i) {
+            _parser_append_last_err(parser, i == 0 ? " '%s'" : ", '%s'", arg->choices[i]);
+        }
+        _parser_append_last_err(parser, ")\n");
+        PARSER_PHASE_LEAVE(parser);
+    }
+    return PARSER_RESULT_ERROR;
+}
+
+parser_result_t parser_choice_add_arg(parser_t* parser, parser_choice_arg_t** arg, char const * keyword,
+                                      char const * const * choices, int choices_count) {
+    if (parser->image != NULL || choices == NULL || choices_count <= 0) {
+        return PARSER_RESULT_ERROR;
+    }
+
+    parser_choice_arg_t* temp = (parser_choice_arg_t*)PARSER_MALLOC(parser, sizeof(parser_choice_arg_t));
+    if (temp == NULL) {
+        return PARSER_RESULT_ERROR;
+    }
+
+    temp->choices = choices;
+    temp->choices_count = choices_count;
+    temp->salt = 0;
+    temp->displacements = NULL;
+    temp->slots = NULL;
+    temp->default_value = -1;
+    temp->value = -1;
+
+    PARSER_PHASE_ENTER(parser, PARSER_PHASE_REGISTRATION);
+    parser_result_t result = _parser_choice_build(parser, temp);
+    PARSER_PHASE_LEAVE(parser);
+    if (result != PARSER_RESULT_OK) {
+        _parser_free_choice_value(temp);
+        free(temp);
+        return result;
+    }
+
+    _parser_add_arg(parser, (parser_base_arg_t*)temp, keyword, _parser_set_choice_value);
+    temp->base.free_value = _parser_free_choice_value;
+
+    *arg = temp;
+    return PARSER_RESULT_OK;
+}
+
+int parser_choice_lookup(parser_choice_arg_t* arg, char const * value) {
+    unsigned int count = (unsigned int)arg->choices_count;
+    int displacement = arg->displacements[_parser_hash(arg->salt, value) % count];
+    int slot = displacement < 0
+        ? -displacement - 1
+        : (int)(_parser_hash((unsigned int)displacement, value) % count);
+
+    int id = arg->slots[slot];
+    if (strcmp(arg->choices[id], value) != 0) {
+        return -1;
+    }
+    return id;
+}
+
+parser_result_t parser_choice_get_checked(parser_t* parser, parser_choice_arg_t* arg, int* value) {
+    parser_result_t result = _parser_check_value(parser, (parser_base_arg_t*)arg);
+    *value = arg->value;
+    return result;
+}
+
+void parser_choice_set_alt(parser_choice_arg_t* arg, char const * alt) {
     _parser_set_alt((parser_base_arg_t*)arg, alt);
 }
 
-void parser_string_set_help(parser_string_arg_t* arg, char const * help) {
+void parser_choice_set_help(parser_choice_arg_t* arg, char const * help) {
     _parser_set_help((parser_base_arg_t*)arg, help);
 }
 
-void parser_string_set_default(parser_string_arg_t* arg, char const * default_value) {
+void parser_choice_set_action(parser_choice_arg_t* arg, parser_action_t action, void* context) {
+    _parser_set_action((parser_base_arg_t*)arg, action, context);
+}
+
+void parser_choice_set_default(parser_choice_arg_t* arg, int default_value) {
     arg->default_value = default_value;
+    if (_parser_holds_default((parser_base_arg_t*)arg)) {
+        arg->value = default_value;
+    }
+}
+
+
+
+typedef enum _parser_path_status_t {
+    PARSER_PATH_STATUS_OK,
+    PARSER_PATH_STATUS_NOT_FOUND,
+    PARSER_PATH_STATUS_NOT_FILE,
+    PARSER_PATH_STATUS_NOT_DIR,
+    PARSER_PATH_STATUS_NOT_READABLE,
+    PARSER_PATH_STATUS_NOT_WRITABLE,
+} _parser_path_status_t;
+
+typedef struct _parser_path_batch_t {
+    parser_path_arg_t** args;
+    int count;
+    int start;
+    int stride;
+} _parser_path_batch_t;
+
+// Runs on the check threads, so it works on the stack instead of going
+// through the counted allocator.
+bool _parser_path_parent_writable(char const * path) {
+    char const * slash = strrchr(path, '/');
+    if (slash == NULL) {
+        return access(".", W_OK) == 0;
+    }
+    if (slash == path) {
+        return access("/", W_OK) == 0;
+    }
+
+    char parent[PATH_MAX];
+    size_t length = (size_t)(slash - path);
+    if (length >= sizeof(parent)) {
+        return false;
+    }
+    memcpy(parent, path, length);
+    parent[length] = '\0';
+    return access(parent, W_OK) == 0;
+}
+
+int _parser_path_status(char const * path, int flags) {
+    struct stat info;
+    if (strcmp(path, "-") == 0) {
+        return PARSER_PATH_STATUS_OK;
+    }
+
+    if (stat(path, &info) != 0) {
+        if (flags & (PARSER_PATH_MUST_EXIST | PARSER_PATH_FILE | PARSER_PATH_DIR | PARSER_PATH_READABLE)) {
+            return PARSER_PATH_STATUS_NOT_FOUND;
+        }
+        if ((flags & PARSER_PATH_WRITABLE) && !_parser_path_parent_writable(path)) {
+            return PARSER_PATH_STATUS_NOT_WRITABLE;
+        }
+        return PARSER_PATH_STATUS_OK;
+    }
+
+    if ((flags & PARSER_PATH_FILE) && !S_ISREG(info.st_mode)) {
+        return PARSER_PATH_STATUS_NOT_FILE;
+    }
+    if ((flags & PARSER_PATH_DIR) && !S_ISDIR(info.st_mode)) {
+        return PARSER_PATH_STATUS_NOT_DIR;
+    }
+    if ((flags & PARSER_PATH_READABLE) && access(path, R_OK) != 0) {
+        return PARSER_PATH_STATUS_NOT_READABLE;
+    }
+    if ((flags & PARSER_PATH_WRITABLE) && access(path, W_OK) != 0) {
+        return PARSER_PATH_STATUS_NOT_WRITABLE;
+    }
+    return PARSER_PATH_STATUS_OK;
+}
+
+void* _parser_path_check_batch(void* data) {
+    _parser_path_batch_t* batch = (_parser_path_batch_t*)data;
+    for (int i = batch->start; i < batch->count; i += batch->stride) {
+        batch->args[i]->status = _parser_path_status(batch->args[i]->value, batch->args[i]->flags);
+    }
+    return NULL;
+}
+
+void _parser_path_run_batches(parser_path_arg_t** args, int count) {
+    _parser_path_batch_t batches[PATH_THREADS];
+    int threads = count / PATH_CHECKS_PER_THREAD;
+    if (threads > PATH_THREADS) {
+        threads = PATH_THREADS;
+    }
+
+#ifndef ARGPARSE_NO_THREADS
+    if (threads > 1) {
+        pthread_t handles[PATH_THREADS];
+        bool started[PATH_THREADS];
+
+        for (int i = 0; i < threads; ++i) {
+            batches[i].args = args;
+            batches[i].count = count;
+            batches[i].start = i;
+            batches[i].stride = threads;
+        }
+
+        for (int i = 1; i < threads; ++i) {
+            started[i] = pthread_create(&handles[i], NULL, _parser_path_check_batch, &batches[i]) == 0;
+        }
+        _parser_path_check_batch(&batches[0]);
+        for (int i = 1; i < threads; ++i) {
+            if (started[i]) {
+                pthread_join(handles[i], NULL);
+            } else {
+                _parser_path_check_batch(&batches[i]);
+            }
+        }
+        return;
+    }
+#endif
+
+    batches[0].args = args;
+    batches[0].count = count;
+    batches[0].start = 0;
+    batches[0].stride = 1;
+    _parser_path_check_batch(&batches[0]);
+}
+
+void _parser_set_path_error_message(parser_t* parser, parser_path_arg_t* arg) {
+    PARSER_PHASE_ENTER(parser, PARSER_PHASE_RENDERING);
+    _parser_begin_arg_error_message(parser, (parser_base_arg_t*)arg);
+    switch (arg->status) {
+    case PARSER_PATH_STATUS_NOT_FOUND:
+        _parser_append_last_err(parser, "path does not exist: '%s'\n", arg->value);
+        break;
+    case PARSER_PATH_STATUS_NOT_FILE:
+        _parser_append_last_err(parser, "not a file: '%s'\n", arg->value);
+        break;
+    case PARSER_PATH_STATUS_NOT_DIR:
+        _parser_append_last_err(parser, "not a directory: '%s'\n", arg->value);
+        break;
+    case PARSER_PATH_STATUS_NOT_READABLE:
+        _parser_append_last_err(parser, "path is not readable: '%s'\n", arg->value);
+        break;
+    default:
+        _parser_append_last_err(parser, "path is not writable: '%s'\n", arg->value);
+        break;
+    }
+    PARSER_PHASE_LEAVE(parser);
+}
+
+parser_result_t _parser_check_paths(parser_t* parser) {
+    int count = 0;
+    for (parser_path_arg_t* current = parser->path_args; current != NULL; current = current->next_path) {
+        if (_parser_is_filled((parser_base_arg_t*)current) && current->flags != 0) {
+            count++;
+        }
+    }
+    if (count == 0) {
+        return PARSER_RESULT_OK;
+    }
+
+    parser_path_arg_t** args = (parser_path_arg_t**)PARSER_MALLOC(parser, sizeof(parser_path_arg_t*) * count);
+    if (args == NULL) {
+        return PARSER_RESULT_ERROR;
+    }
+
+    count = 0;
+    for (parser_path_arg_t* current = parser->path_args; current != NULL; current = current->next_path) {
+        if (_parser_is_filled((parser_base_arg_t*)current) && current->flags != 0) {
+            _parser_check_value(parser, (parser_base_arg_t*)current);
+            args[count++] = current;
+        }
+    }
+
+    _parser_path_run_batches(args, count);
+
+    parser_result_t result = PARSER_RESULT_OK;
+    for (int i = 0; i < count; ++i) {
+        if (args[i]->status != PARSER_PATH_STATUS_OK) {
+            _parser_set_path_error_message(parser, args[i]);
+            result = PARSER_RESULT_ERROR;
+            break;
+        }
+    }
+
+    free(args);
+    return result;
+}
+
+parser_result_t _parser_set_path_value(parser_t* parser, void* element, char const * value) {
+    ((parser_path_arg_t*)element)->value = value;
+    return PARSER_RESULT_OK;
+}
+
+parser_result_t parser_path_add_arg(parser_t* parser, parser_path_arg_t** arg, char const * keyword, int flags) {
+    if (parser->image != NULL) {
+        return PARSER_RESULT_ERROR;
+    }
+
+    parser_path_arg_t* temp = (parser_path_arg_t*)PARSER_MALLOC(parser, sizeof(parser_path_arg_t));
+    if (temp == NULL) {
+        return PARSER_RESULT_ERROR;
+    }
+
+    _parser_add_arg(parser, (parser_base_arg_t*)temp, keyword, _parser_set_path_value);
+    temp->flags = flags;
+    temp->status = PARSER_PATH_STATUS_OK;
+    temp->default_value = "";
+    temp->value = "";
+    temp->next_path = NULL;
+
+    parser_path_arg_t** pointer = &parser->path_args;
+    while (*pointer != NULL) {
+        pointer = &(*pointer)->next_path;
+    }
+    *pointer = temp;
+
+    *arg = temp;
+    return PARSER_RESULT_OK;
+}
+
+void parser_path_set_alt(parser_path_arg_t* arg, char const * alt) {
+    _parser_set_alt((parser_base_arg_t*)arg, alt);
+}
+
+void parser_path_set_help(parser_path_arg_t* arg, char const * help) {
+    _parser_set_help((parser_base_arg_t*)arg, help);
+}
+
+void parser_path_set_action(parser_path_arg_t* arg, parser_action_t action, void* context) {
+    _parser_set_action((parser_base_arg_t*)arg, action, context);
+}
+
+void parser_path_set_default(parser_path_arg_t* arg, char const * default_value) {
+    arg->default_value = default_value;
+    if (_parser_holds_default((parser_base_arg_t*)arg)) {
+        arg->value = default_value;
+    }
+}
+
+
+
+enum {
+    PARSER_IMAGE_VERSION = 1,
+};
+
+typedef enum _parser_image_type_t {
+    PARSER_IMAGE_FLAG,
+    PARSER_IMAGE_HELP,
+    PARSER_IMAGE_INT,
+    PARSER_IMAGE_STRING,
+    PARSER_IMAGE_CHOICE,
+    PARSER_IMAGE_PATH,
+} _parser_image_type_t;
+
+// Every reference inside an image is an offset from its start, 0 stands for
+// NULL since the header always lives there.
+typedef struct _parser_image_header_t {
+    char magic[4];
+    uint32_t version;
+    uint32_t size;
+    uint32_t arg_count;
+    uint32_t args_offset;
+    uint32_t index_size;
+    uint32_t index_offset;
+} _parser_image_header_t;
+
+typedef struct _parser_image_arg_t {
+    uint32_t type;
+    uint32_t is_positional;
+    uint32_t keyword;
+    uint32_t keyshort;
+    uint32_t help;
+    uint32_t flags;
+    int32_t default_int;
+    uint32_t default_string;
+    uint32_t choices;
+    int32_t choices_count;
+    uint32_t salt;
+    uint32_t displacements;
+    uint32_t slots;
+} _parser_image_arg_t;
+
+typedef struct _parser_image_writer_t {
+    parser_t* parser;
+    char* data;
+    size_t size;
+    size_t capacity;
+    bool failed;
+} _parser_image_writer_t;
+
+uint32_t _parser_image_reserve(_parser_image_writer_t* writer, size_t size, size_t align) {
+    size_t offset = (writer->size + align - 1) & ~(align - 1);
+    if (writer->failed || offset + size > UINT32_MAX) {
+        writer->failed = true;
+        return 0;
+    }
+
+    if (offset + size > writer->capacity) {
+        size_t capacity = writer->capacity != 0 ? writer->capacity : (size_t)INITIAL_BUFFER_SIZE;
+        while (capacity < offset + size) {
+            capacity *= 2;
+        }
+
+        char* data = (char*)realloc(writer->data, capacity);
+        if (data == NULL) {
+            writer->failed = true;
+            return 0;
+        }
+        PARSER_STATS_ADD(writer->parser, allocations, 1);
+        PARSER_STATS_ADD(writer->parser, allocated_bytes, capacity);
+        writer->data = data;
+        writer->capacity = capacity;
+    }
+
+    memset(&writer->data[writer->size], 0, offset + size - writer->size);
+    writer->size = offset + size;
+    return (uint32_t)offset;
+}
+
+uint32_t _parser_image_put_string(_parser_image_writer_t* writer, char const * value) {
+    if (value == NULL) {
+        return 0;
+    }
+
+    size_t length = strlen(value) + 1;
+    uint32_t offset = _parser_image_reserve(writer, length, 1);
+    if (!writer->failed) {
+        memcpy(&writer->data[offset], value, length);
+    }
+    return offset;
+}
+
+int _parser_image_type(parser_t* parser, parser_base_arg_t* element) {
+    if (element == (parser_base_arg_t*)parser->help_arg) {
+        return PARSER_IMAGE_HELP;
+    } else if (element->set_value == NULL) {
+        return PARSER_IMAGE_FLAG;
+    } else if (element->set_value == _parser_set_int_value) {
+        return PARSER_IMAGE_INT;
+    } else if (element->set_value == _parser_set_string_value) {
+        return PARSER_IMAGE_STRING;
+    } else if (element->set_value == _parser_set_choice_value) {
+        return PARSER_IMAGE_CHOICE;
+    } else if (element->set_value == _parser_set_path_value) {
+        return PARSER_IMAGE_PATH;
+    }
+    return -1;
+}
+
+void _parser_image_put_arg(_parser_image_writer_t* writer, uint32_t record_offset,
+                           parser_base_arg_t* element, int type, bool is_positional) {
+    _parser_image_arg_t record;
+    memset(&record, 0, sizeof(record));
+    record.type = (uint32_t)type;
+    record.is_positional = is_positional;
+    record.keyword = _parser_image_put_string(writer, element->keyword);
+    record.keyshort = _parser_image_put_string(writer, element->keyshort);
+    record.help = _parser_image_put_string(writer, element->help);
+
+    if (type == PARSER_IMAGE_INT) {
+        record.default_int = ((parser_int_arg_t*)element)->default_value;
+    } else if (type == PARSER_IMAGE_STRING) {
+        record.default_string = _parser_image_put_string(writer, ((parser_string_arg_t*)element)->default_value);
+    } else if (type == PARSER_IMAGE_PATH) {
+        record.flags = (uint32_t)((parser_path_arg_t*)element)->flags;
+        record.default_string = _parser_image_put_string(writer, ((parser_path_arg_t*)element)->default_value);
+    } else if (type == PARSER_IMAGE_CHOICE) {
+        parser_choice_arg_t* arg = (parser_choice_arg_t*)element;
+        size_t count = (size_t)arg->choices_count;
+        record.default_int = arg->default_value;
+        record.choices_count = arg->choices_count;
+        record.salt = arg->salt;
+        record.choices = _parser_image_reserve(writer, sizeof(uint32_t) * count, sizeof(uint32_t));
+        record.displacements = _parser_image_reserve(writer, sizeof(int32_t) * count, sizeof(int32_t));
+        record.slots = _parser_image_reserve(writer, sizeof(int32_t) * count, sizeof(int32_t));
+        for (size_t i = 0; i < count && !writer->failed; ++i) {
+            uint32_t name = _parser_image_put_string(writer, arg->choices[i]);
+            if (!writer->failed) {
+                ((uint32_t*)&writer->data[record.choices])[i] = name;
+                ((int32_t*)&writer->data[record.displacements])[i] = arg->displacements[i];
+                ((int32_t*)&writer->data[record.slots])[i] = arg->slots[i];
+            }
+        }
+    }
+
+    if (!writer->failed) {
+        memcpy(&writer->data[record_offset], &record, sizeof(record));
+    }
+}
+
+void _parser_image_put_index(char* data, uint32_t index_offset, uint32_t mask, char const * name, uint32_t entry) {
+    uint32_t* index = (uint32_t*)&data[index_offset];
+    uint32_t position = _parser_hash(0, name) & mask;
+    while (index[position] != 0) {
+        position = (position + 1) & mask;
+    }
+    index[position] = entry;
+}
+
+parser_result_t parser_image_build(parser_t* parser, void** image, size_t* size) {
+    uint32_t arg_count = 0;
+    uint32_t name_count = 0;
+    for (parser_base_arg_t* current = parser->optional_args; current != NULL; current = current->next) {
+        arg_count++;
+        name_count += (current->keyword != NULL) + (current->keyshort != NULL);
+    }
+    for (parser_base_arg_t* current = parser->positional_args; current != NULL; current = current->next) {
+        arg_count++;
+    }
+
+    uint32_t index_size = 2;
+    while (index_size < 2 * name_count) {
+        index_size *= 2;
+    }
+
+    _parser_image_writer_t writer = { parser, NULL, 0, 0, false };
+    _parser_image_reserve(&writer, sizeof(_parser_image_header_t), 8);
+    uint32_t args_offset = _parser_image_reserve(&writer, sizeof(_parser_image_arg_t) * arg_count, 8);
+    uint32_t index_offset = _parser_image_reserve(&writer, sizeof(uint32_t) * index_size, 8);
+
+    uint32_t record = 0;
+    parser_base_arg_t* lists[] = { parser->optional_args, parser->positional_args };
+    for (int list = 0; list < 2; ++list) {
+        for (parser_base_arg_t* current = lists[list]; current != NULL; current = current->next) {
+            int type = _parser_image_type(parser, current);
+            if (type < 0) {
+                writer.failed = true;
+                break;
+            }
+
+            _parser_image_put_arg(&writer, args_offset + record * sizeof(_parser_image_arg_t), current, type, list == 1);
+            if (!writer.failed && list == 0) {
+                if (current->keyword != NULL) {
+                    _parser_image_put_index(writer.data, index_offset, index_size - 1, current->keyword, record + 1);
+                }
+                if (current->keyshort != NULL) {
+                    _parser_image_put_index(writer.data, index_offset, index_size - 1, current->keyshort, record + 1);
+                }
+            }
+            record++;
+        }
+    }
+
+    if (writer.failed) {
+        free(writer.data);
+        return PARSER_RESULT_ERROR;
+    }
+
+    _parser_image_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "APSI", 4);
+    header.version = PARSER_IMAGE_VERSION;
+    header.size = (uint32_t)writer.size;
+    header.arg_count = arg_count;
+    header.args_offset = args_offset;
+    header.index_size = index_size;
+    header.index_offset = index_offset;
+    memcpy(writer.data, &header, sizeof(header));
+
+    *image = writer.data;
+    *size = writer.size;
+    return PARSER_RESULT_OK;
+}
+
+// Strings and choice tables live in the pool placed after the index, so
+// nothing can alias the header, the records or the index.
+bool _parser_image_check_string(char const * base, size_t size, size_t pool, uint32_t offset) {
+    return offset == 0 || (offset >= pool && offset < size && memchr(&base[offset], '\0', size - offset) != NULL);
+}
+
+// Usage rendering skips the "--" / "-" prefix of option names unchecked.
+bool _parser_image_check_name(char const * base, uint32_t offset, bool is_long) {
+    if (offset == 0) {
+        return true;
+    }
+
+    char const * name = &base[offset];
+    return is_long
+        ? _parser_prefix("--", name) && name[2] != '\0'
+        : name[0] == '-' && name[1] != '-' && name[1] != '\0';
+}
+
+bool _parser_image_check_array(size_t size, uint32_t offset, size_t length) {
+    return offset % sizeof(uint32_t) == 0 && offset <= size && length <= (size - offset) / sizeof(uint32_t);
+}
+
+size_t _parser_image_arg_size(_parser_image_arg_t const * record) {
+    switch (record->type) {
+    case PARSER_IMAGE_FLAG:
+    case PARSER_IMAGE_HELP:
+        return sizeof(parser_flag_arg_t);
+    case PARSER_IMAGE_INT:
+        return sizeof(parser_int_arg_t);
+    case PARSER_IMAGE_STRING:
+        return sizeof(parser_string_arg_t);
+    case PARSER_IMAGE_CHOICE:
+        return sizeof(parser_choice_arg_t) + sizeof(char const *) * (size_t)record->choices_count;
+    case PARSER_IMAGE_PATH:
+        return sizeof(parser_path_arg_t);
+    }
+    return 0;
+}
+
+bool _parser_image_check_arg(char const * base, size_t size, size_t pool, _parser_image_arg_t const * record) {
+    if (_parser_image_arg_size(record) == 0 ||
+        !_parser_image_check_string(base, size, pool, record->keyword) ||
+        !_parser_image_check_string(base, size, pool, record->keyshort) ||
+        !_parser_image_check_string(base, size, pool, record->help) ||
+        !_parser_image_check_string(base, size, pool, record->default_string) ||
+        !_parser_image_check_name(base, record->keyshort, false)) {
+        return false;
+    }
+    if (record->is_positional) {
+        if (record->keyword == 0 || base[record->keyword] == '-' ||
+            record->type == PARSER_IMAGE_FLAG || record->type == PARSER_IMAGE_HELP) {
+            return false;
+        }
+    } else if ((record->keyword == 0 && record->keyshort == 0) ||
+               !_parser_image_check_name(base, record->keyword, true)) {
+        return false;
+    }
+
+    if (record->type == PARSER_IMAGE_CHOICE) {
+        size_t count = (size_t)record->choices_count;
+        if (record->choices_count <= 0 ||
+            record->choices < pool || record->displacements < pool || record->slots < pool ||
+            !_parser_image_check_array(size, record->choices, count) ||
+            !_parser_image_check_array(size, record->displacements, count) ||
+            !_parser_image_check_array(size, record->slots, count)) {
+            return false;
+        }
+
+        uint32_t const * choices = (uint32_t const *)&base[record->choices];
+        int32_t const * slots = (int32_t const *)&base[record->slots];
+        int32_t const * displacements = (int32_t const *)&base[record->displacements];
+        for (size_t i = 0; i < count; ++i) {
+            if (choices[i] == 0 || !_parser_image_check_string(base, size, pool, choices[i]) ||
+                slots[i] < 0 || slots[i] >= record->choices_count ||
+                displacements[i] < -record->choices_count) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+parser_result_t parser_image_attach(parser_t** parser, void const * image, size_t size) {
+    char const * base = (char const *)image;
+    _parser_image_header_t header;
+    // Records and the index are read in place, the writer aligns them to 8.
+    if (image == NULL || (uintptr_t)image % 8 != 0 || size < sizeof(header)) {
+        return PARSER_RESULT_ERROR;
+    }
+
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, "APSI", 4) != 0 || header.version != PARSER_IMAGE_VERSION || header.size != size ||
+        header.args_offset % 8 != 0 || header.args_offset < sizeof(header) || header.args_offset > size ||
+        header.arg_count > (size - header.args_offset) / sizeof(_parser_image_arg_t) ||
+        header.index_offset < header.args_offset + (size_t)header.arg_count * sizeof(_parser_image_arg_t) ||
+        header.index_size == 0 || (header.index_size & (header.index_size - 1)) != 0 ||
+        !_parser_image_check_array(size, header.index_offset, header.index_size)) {
+        return PARSER_RESULT_ERROR;
+    }
+    size_t pool = header.index_offset + (size_t)header.index_size * sizeof(uint32_t);
+
+    _parser_image_arg_t const * records = (_parser_image_arg_t const *)&base[header.args_offset];
+    uint32_t const * index = (uint32_t const *)&base[header.index_offset];
+    uint32_t free_entries = 0;
+    for (uint32_t i = 0; i < header.index_size; ++i) {
+        if (index[i] > header.arg_count || (index[i] != 0 && records[index[i] - 1].is_positional)) {
+            return PARSER_RESULT_ERROR;
+        }
+        free_entries += index[i] == 0;
+    }
+    if (free_entries == 0) {
+        return PARSER_RESULT_ERROR;
+    }
+
+    const size_t align = sizeof(void*) > sizeof(uint64_t) ? sizeof(void*) : sizeof(uint64_t);
+    size_t block_size = (sizeof(parser_t) + align - 1) & ~(align - 1);
+    block_size += (sizeof(parser_base_arg_t*) * header.arg_count + align - 1) & ~(align - 1);
+    bool has_help = false;
+    for (uint32_t i = 0; i < header.arg_count; ++i) {
+        if (!_parser_image_check_arg(base, size, pool, &records[i])) {
+            return PARSER_RESULT_ERROR;
+        }
+        has_help = has_help || records[i].type == PARSER_IMAGE_HELP;
+        block_size += (_parser_image_arg_size(&records[i]) + align - 1) & ~(align - 1);
+    }
+    if (!has_help) {
+        return PARSER_RESULT_ERROR;
+    }
+
+    char* block = (char*)malloc(block_size);
+    if (block == NULL) {
+        return PARSER_RESULT_ERROR;
+    }
+
+    parser_t* temp = (parser_t*)block;
+    _parser_init_parser(temp);
+    PARSER_STATS_ADD(temp, allocations, 1);
+    PARSER_STATS_ADD(temp, allocated_bytes, block_size);
+    PARSER_PHASE_ENTER(temp, PARSER_PHASE_REGISTRATION);
+
+    size_t offset = (sizeof(parser_t) + align - 1) & ~(align - 1);
+    temp->image = image;
+    temp->image_args = (parser_base_arg_t**)&block[offset];
+    temp->image_index = index;
+    temp->image_index_mask = header.index_size - 1;
+    offset += (sizeof(parser_base_arg_t*) * header.arg_count + align - 1) & ~(align - 1);
+
+    parser_base_arg_t** optional_tail = &temp->optional_args;
+    parser_base_arg_t** positional_tail = &temp->positional_args;
+    parser_path_arg_t** path_tail = &temp->path_args;
+    for (uint32_t i = 0; i < header.arg_count; ++i) {
+        _parser_image_arg_t const * record = &records[i];
+        parser_base_arg_t* element = (parser_base_arg_t*)&block[offset];
+        offset += (_parser_image_arg_size(record) + align - 1) & ~(align - 1);
+
+        char const * default_string = record->default_string != 0 ? &base[record->default_string] : NULL;
+        switch (record->type) {
+        case PARSER_IMAGE_FLAG:
+        case PARSER_IMAGE_HELP:
+            _parser_init_arg(element, NULL);
+            if (record->type == PARSER_IMAGE_HELP) {
+                temp->help_arg = (parser_flag_arg_t*)element;
+            }
+            break;
+        case PARSER_IMAGE_INT:
+            _parser_init_arg(element, _parser_set_int_value);
+            ((parser_int_arg_t*)element)->default_value = record->default_int;
+            ((parser_int_arg_t*)element)->value = record->default_int;
+            break;
+        case PARSER_IMAGE_STRING:
+            _parser_init_arg(element, _parser_set_string_value);
+            ((parser_string_arg_t*)element)->default_value = default_string;
+            ((parser_string_arg_t*)element)->value = default_string;
+            break;
+        case PARSER_IMAGE_CHOICE: {
+            parser_choice_arg_t* arg = (parser_choice_arg_t*)element;
+            char const ** choices = (char const **)(arg + 1);
+            uint32_t const * names = (uint32_t const *)&base[record->choices];
+            for (int32_t j = 0; j < record->choices_count; ++j) {
+                choices[j] = &base[names[j]];
+            }
+
+            _parser_init_arg(element, _parser_set_choice_value);
+            arg->choices = choices;
+            arg->choices_count = record->choices_count;
+            arg->salt = record->salt;
+            arg->displacements = (int*)&base[record->displacements];
+            arg->slots = (int*)&base[record->slots];
+            arg->default_value = record->default_int;
+            arg->value = record->default_int;
+            break;
+        }
+        case PARSER_IMAGE_PATH: {
+            parser_path_arg_t* arg = (parser_path_arg_t*)element;
+            _parser_init_arg(element, _parser_set_path_value);
+            arg->flags = (int)record->flags;
+            arg->status = PARSER_PATH_STATUS_OK;
+            arg->default_value = default_string;
+            arg->value = default_string;
+            arg->next_path = NULL;
+            *path_tail = arg;
+            path_tail = &arg->next_path;
+            break;
+        }
+        }
+
+        element->parser = temp;
+        element->keyword = record->keyword != 0 ? &base[record->keyword] : NULL;
+        element->keyshort = record->keyshort != 0 ? &base[record->keyshort] : NULL;
+        element->help = record->help != 0 ? &base[record->help] : NULL;
+        temp->image_args[i] = element;
+
+        if (record->is_positional) {
+            *positional_tail = element;
+            positional_tail = &element->next;
+        } else {
+            *optional_tail = element;
+            optional_tail = &element->next;
+        }
+    }
+
+    PARSER_PHASE_LEAVE(temp);
+    *parser = temp;
+    return PARSER_RESULT_OK;
+}
+
+parser_base_arg_t* _parser_image_find_optional(parser_t* parser, char const * name) {
+    uint32_t position = _parser_hash(0, name) & parser->image_index_mask;
+    bool is_long = _parser_prefix("--", name);
+
+    for (uint32_t entry = parser->image_index[position]; entry != 0; entry = parser->image_index[position]) {
+        parser_base_arg_t* current = parser->image_args[entry - 1];
+        char const * key = is_long ? current->keyword : current->keyshort;
+        PARSER_STATS_ADD(parser, lookup_comparisons, key != NULL);
+        if (key != NULL && strcmp(key, name) == 0) {
+            return current;
+        }
+        position = (position + 1) & parser->image_index_mask;
+    }
+    return NULL;
 }
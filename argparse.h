@@ -7,18 +7,63 @@
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#ifdef ARGPARSE_STATS
+#include <time.h>
+#endif
+
+// argparse_single.h (make argparse_single.h) bundles this header with
+// argparse.c; define ARGPARSE_IMPLEMENTATION in exactly one translation unit
+// before including it. It also defines ARGPARSE_INLINE_GETTERS, so the value
+// accessors below become static inline single loads. The implementation
+// relies on POSIX.1-2008 (clock_gettime for ARGPARSE_STATS), so in that
+// translation unit include it before any system header or compile with
+// -D_POSIX_C_SOURCE=200809L.
+#ifdef ARGPARSE_INLINE_GETTERS
+#define PARSER_GETTER static inline
+#else
+#define PARSER_GETTER
+#endif
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+    typedef enum parser_result_t {
+        PARSER_RESULT_OK,
+        PARSER_RESULT_HELP,
+        PARSER_RESULT_ERROR,
+        PARSER_RESULT_STOP,
+    } parser_result_t;
+
+    struct parser_t;
+
+    // Called each time the arg accepts a token, after its value is set.
+    // Return PARSER_RESULT_OK to continue, PARSER_RESULT_STOP to end the
+    // parse early (parser_parse returns it and skips validation, except for
+    // the checks of path args filled so far) or
+    // PARSER_RESULT_ERROR to abort, after describing the failure with
+    // parser_set_arg_error (a generic message is used otherwise).
+    typedef parser_result_t (*parser_action_t)(struct parser_t* parser, void* arg, void* context);
+
     typedef struct parser_base_arg_t {
         char const * keyword;
         char const * keyshort;
         char const * help;
         bool is_filled;
-        void (*set_value)(void* element, char const * value);
+        parser_result_t (*set_value)(struct parser_t* parser, void* element, char const * value);
+        void (*free_value)(void* element);
+        parser_action_t action;
+        void* action_context;
+#ifdef ARGPARSE_LAZY
+        char const * raw_value;
+        bool is_pending;
+        bool is_invalid;
+#endif
         struct parser_base_arg_t* next;
+        struct parser_t* parser;
     } parser_base_arg_t;
 
     typedef struct parser_flag_arg_t {
@@ -37,6 +82,71 @@ extern "C" {
         char const * value;
     } parser_string_arg_t;
 
+#ifdef ARGPARSE_STATS
+    typedef enum parser_phase_t {
+        PARSER_PHASE_REGISTRATION,
+        PARSER_PHASE_PARSE,
+        PARSER_PHASE_VALIDATION,
+        PARSER_PHASE_RENDERING,
+        PARSER_PHASE_COUNT,
+    } parser_phase_t;
+
+    // Counters are cumulative over the parser lifetime, phase times are
+    // exclusive (rendering an error message is not counted as parse time).
+    // Every heap allocation the library makes for a parser is counted,
+    // scratch buffers included; a realloc counts as one allocation of the
+    // new size. Path checks allocate nothing, as they may run on threads.
+    typedef struct parser_stats_t {
+        unsigned long tokens;
+        unsigned long lookups;
+        unsigned long lookup_comparisons;
+        unsigned long allocations;
+        unsigned long allocated_bytes;
+        unsigned long last_err_grows;
+        unsigned long long phase_ns[PARSER_PHASE_COUNT];
+
+        parser_phase_t current_phase;
+        unsigned long long phase_started_ns;
+    } parser_stats_t;
+#endif
+
+    // Choices are resolved through a minimal perfect hash built on
+    // registration: slots[] maps a hash slot to the choice id and
+    // displacements[] holds the per-bucket seed (or the direct slot, encoded
+    // as -slot-1, for single-key buckets), salt selects the bucket hash.
+    typedef struct parser_choice_arg_t {
+        parser_base_arg_t base;
+        char const * const * choices;
+        int choices_count;
+        unsigned int salt;
+        int* displacements;
+        int* slots;
+        int default_value;
+        int value;
+    } parser_choice_arg_t;
+
+    typedef enum parser_path_flags_t {
+        PARSER_PATH_MUST_EXIST = 1 << 0,
+        PARSER_PATH_FILE = 1 << 1,
+        PARSER_PATH_DIR = 1 << 2,
+        PARSER_PATH_READABLE = 1 << 3,
+        PARSER_PATH_WRITABLE = 1 << 4,
+    } parser_path_flags_t;
+
+    // Path checks run in one batch after the argv walk. Each path arg holds
+    // a single value, so the batch only spreads over threads (started for
+    // that parse, there is no persistent pool) when at least 32 path args
+    // are filled; smaller batches are checked inline. "-" is always
+    // accepted as stdin/stdout.
+    typedef struct parser_path_arg_t {
+        parser_base_arg_t base;
+        int flags;
+        int status;
+        char const * default_value;
+        char const * value;
+        struct parser_path_arg_t* next_path;
+    } parser_path_arg_t;
+
     typedef struct parser_t {
         int argc;
         char** argv;
@@ -48,38 +158,176 @@ extern "C" {
         parser_flag_arg_t* help_arg;
         parser_base_arg_t* optional_args;
         parser_base_arg_t* positional_args;
-    } parser_t;
+        parser_path_arg_t* path_args;
 
-    typedef enum parser_result_t {
-        PARSER_RESULT_OK,
-        PARSER_RESULT_HELP,
-        PARSER_RESULT_ERROR,
-    } parser_result_t;
+        // "Did you mean" suggestions are only computed by parser_get_last_err.
+        // The option names are then indexed by length, the index is dropped
+        // when an arg is added.
+        char const * unrecognized;
+        char const ** suggest_names;
+        unsigned long long* suggest_masks;
+        unsigned char* suggest_lcps;
+        int* suggest_offsets;
+        int suggest_max_length;
+
+        // Set when the parser is attached to a compiled schema image, the
+        // option lookups then go through the image hash index.
+        void const * image;
+        parser_base_arg_t** image_args;
+        uint32_t const * image_index;
+        uint32_t image_index_mask;
+
+#ifdef ARGPARSE_LAZY
+        bool is_lazy;
+#endif
+
+#ifdef ARGPARSE_STATS
+        parser_stats_t stats;
+#endif
+    } parser_t;
 
     parser_result_t parser_init(parser_t** parser);
     parser_result_t parser_free(parser_t** parser);
     parser_result_t parser_parse(parser_t* parser, int argc, char** argv);
     const char* parser_get_last_err(parser_t* parser);
+    // Renders "argument X: message" with the usage line as the last error.
+    void parser_set_arg_error(parser_t* parser, void* arg, char const * message);
+    parser_base_arg_t* parser_find_arg(parser_t* parser, char const * name);
+
+    // Compiles the registered args into a relocatable image which only holds
+    // offsets (names, help, defaults, choice tables and the option lookup
+    // index). It can be written to a file or shared memory and attached by
+    // any process built from the same argparse.c; release it with free().
+    parser_result_t parser_image_build(parser_t* parser, void** image, size_t* size);
+    // Creates a parser working against a read-only image, which must be
+    // 8-byte aligned (as malloc and mmap return it) and outlive it. Args
+    // cannot be added to an attached parser, use parser_find_arg to reach
+    // them. Their names live in the image index too, so set_alt is ignored
+    // on them.
+    parser_result_t parser_image_attach(parser_t** parser, void const * image, size_t size);
+
+#ifdef ARGPARSE_LAZY
+    // In lazy mode parsing only records the token which supplied each arg,
+    // conversion runs on the first get_value and is memoized. Failed
+    // conversions leave the default in place, use the get_checked variants
+    // to have them reported. Since that first read writes to the arg, lazy
+    // getters must not race: read every value once (e.g. in the action)
+    // before handing args to other threads.
+    void parser_set_lazy(parser_t* parser, bool is_lazy);
+    parser_result_t _parser_convert_value(parser_t* parser, parser_base_arg_t* element);
+#endif
+
+#ifdef ARGPARSE_STATS
+    parser_result_t parser_get_stats(parser_t* parser, parser_stats_t* stats);
+
+    // Never inlined, so they can be used as uprobe targets, e.g.
+    // perf probe -x ./app 'parser_trace_phase_begin phase=%di:s32'
+    void parser_trace_phase_begin(parser_phase_t phase);
+    void parser_trace_phase_end(parser_phase_t phase);
+#endif
 
     parser_result_t parser_flag_add_arg(parser_t* parser, parser_flag_arg_t** arg, char const * keyword);
-    bool parser_flag_is_filled(parser_flag_arg_t* arg);
+    PARSER_GETTER bool parser_flag_is_filled(parser_flag_arg_t* arg);
     void parser_flag_set_alt(parser_flag_arg_t* arg, char const * alt);
     void parser_flag_set_help(parser_flag_arg_t* arg, char const * help);
+    void parser_flag_set_action(parser_flag_arg_t* arg, parser_action_t action, void* context);
 
     parser_result_t parser_int_add_arg(parser_t* parser, parser_int_arg_t** arg, char const * keyword);
-    int parser_int_get_value(parser_int_arg_t* arg);
-    bool parser_int_is_filled(parser_int_arg_t* arg);
+    PARSER_GETTER int parser_int_get_value(parser_int_arg_t* arg);
+    parser_result_t parser_int_get_checked(parser_t* parser, parser_int_arg_t* arg, int* value);
+    PARSER_GETTER bool parser_int_is_filled(parser_int_arg_t* arg);
     void parser_int_set_alt(parser_int_arg_t* arg, char const * alt);
     void parser_int_set_help(parser_int_arg_t* arg, char const * help);
+    void parser_int_set_action(parser_int_arg_t* arg, parser_action_t action, void* context);
     void parser_int_set_default(parser_int_arg_t* arg, int default_value);
 
     parser_result_t parser_string_add_arg(parser_t* parser, parser_string_arg_t** arg, char const * keyword);
-    const char* parser_string_get_value(parser_string_arg_t* arg);
-    bool parser_string_is_filled(parser_string_arg_t* arg);
+    PARSER_GETTER const char* parser_string_get_value(parser_string_arg_t* arg);
+    PARSER_GETTER bool parser_string_is_filled(parser_string_arg_t* arg);
     void parser_string_set_alt(parser_string_arg_t* arg, char const * alt);
     void parser_string_set_help(parser_string_arg_t* arg, char const * help);
+    void parser_string_set_action(parser_string_arg_t* arg, parser_action_t action, void* context);
     void parser_string_set_default(parser_string_arg_t* arg, char const * default_value);
 
+    parser_result_t parser_choice_add_arg(parser_t* parser, parser_choice_arg_t** arg, char const * keyword,
+                                          char const * const * choices, int choices_count);
+    PARSER_GETTER int parser_choice_get_value(parser_choice_arg_t* arg);
+    parser_result_t parser_choice_get_checked(parser_t* parser, parser_choice_arg_t* arg, int* value);
+    int parser_choice_lookup(parser_choice_arg_t* arg, char const * value);
+    PARSER_GETTER bool parser_choice_is_filled(parser_choice_arg_t* arg);
+    void parser_choice_set_alt(parser_choice_arg_t* arg, char const * alt);
+    void parser_choice_set_help(parser_choice_arg_t* arg, char const * help);
+    void parser_choice_set_action(parser_choice_arg_t* arg, parser_action_t action, void* context);
+    void parser_choice_set_default(parser_choice_arg_t* arg, int default_value);
+
+    parser_result_t parser_path_add_arg(parser_t* parser, parser_path_arg_t** arg, char const * keyword, int flags);
+    PARSER_GETTER const char* parser_path_get_value(parser_path_arg_t* arg);
+    PARSER_GETTER bool parser_path_is_filled(parser_path_arg_t* arg);
+    void parser_path_set_alt(parser_path_arg_t* arg, char const * alt);
+    void parser_path_set_help(parser_path_arg_t* arg, char const * help);
+    void parser_path_set_action(parser_path_arg_t* arg, parser_action_t action, void* context);
+    void parser_path_set_default(parser_path_arg_t* arg, char const * default_value);
+
+    // Defaults are written through to the value slot, so accessors never
+    // branch on is_filled.
+#if defined(ARGPARSE_INLINE_GETTERS) || defined(ARGPARSE_DEFINE_GETTERS)
+    PARSER_GETTER bool parser_flag_is_filled(parser_flag_arg_t* arg) {
+        return arg->base.is_filled;
+    }
+
+    PARSER_GETTER int parser_int_get_value(parser_int_arg_t* arg) {
+#ifdef ARGPARSE_LAZY
+        if (arg->base.is_pending) {
+            _parser_convert_value(NULL, (parser_base_arg_t*)arg);
+        }
+#endif
+        return arg->value;
+    }
+
+    PARSER_GETTER bool parser_int_is_filled(parser_int_arg_t* arg) {
+        return arg->base.is_filled;
+    }
+
+    PARSER_GETTER const char* parser_string_get_value(parser_string_arg_t* arg) {
+#ifdef ARGPARSE_LAZY
+        if (arg->base.is_pending) {
+            _parser_convert_value(NULL, (parser_base_arg_t*)arg);
+        }
+#endif
+        return arg->value;
+    }
+
+    PARSER_GETTER bool parser_string_is_filled(parser_string_arg_t* arg) {
+        return arg->base.is_filled;
+    }
+
+    PARSER_GETTER int parser_choice_get_value(parser_choice_arg_t* arg) {
+#ifdef ARGPARSE_LAZY
+        if (arg->base.is_pending) {
+            _parser_convert_value(NULL, (parser_base_arg_t*)arg);
+        }
+#endif
+        return arg->value;
+    }
+
+    PARSER_GETTER bool parser_choice_is_filled(parser_choice_arg_t* arg) {
+        return arg->base.is_filled;
+    }
+
+    PARSER_GETTER const char* parser_path_get_value(parser_path_arg_t* arg) {
+#ifdef ARGPARSE_LAZY
+        if (arg->base.is_pending) {
+            _parser_convert_value(NULL, (parser_base_arg_t*)arg);
+        }
+#endif
+        return arg->value;
+    }
+
+    PARSER_GETTER bool parser_path_is_filled(parser_path_arg_t* arg) {
+        return arg->base.is_filled;
+    }
+#endif
+
 #ifdef __cplusplus
 }
 #endif
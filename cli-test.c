@@ -45,6 +45,21 @@ int main(int argc, char** argv) {
         printf("%s", parser_get_last_err(parser));
     }
 
+#ifdef ARGPARSE_STATS
+    parser_stats_t stats;
+    parser_get_stats(parser, &stats);
+    printf("\n");
+    printf("tokens=%lu\n", stats.tokens);
+    printf("lookups=%lu comparisons=%lu\n", stats.lookups, stats.lookup_comparisons);
+    printf("allocations=%lu bytes=%lu last_err_grows=%lu\n",
+           stats.allocations, stats.allocated_bytes, stats.last_err_grows);
+    printf("registration=%lluns parse=%lluns validation=%lluns rendering=%lluns\n",
+           stats.phase_ns[PARSER_PHASE_REGISTRATION],
+           stats.phase_ns[PARSER_PHASE_PARSE],
+           stats.phase_ns[PARSER_PHASE_VALIDATION],
+           stats.phase_ns[PARSER_PHASE_RENDERING]);
+#endif
+
     parser_free(&parser);
 
     return 0;
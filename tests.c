@@ -95,6 +95,89 @@ void test_Parser_OptionalArgsError() {
     parser_free(&parser);
 }
 
+void test_Parser_OptionalArgsSuggestion() {
+    parser_t* parser;
+    parser_string_arg_t* input_arg;
+    parser_string_arg_t* output_arg;
+    parser_int_arg_t* opt_int_arg;
+    parser_string_arg_t* opt_str_arg;
+    char* args[] = { "exename", "--frist", "1" };
+
+    init_parser(&parser, &input_arg, &output_arg, &opt_int_arg, &opt_str_arg, NULL, true, false);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 3, args), "Parse Error");
+    TEST_ASSERT_EQUAL_STRING("usage: exename [-h] [-f FIRST] [-s SECOND] input output\n"
+                             "exename: error: unrecognized arguments: --frist\n",
+                             parser->last_err);
+    TEST_ASSERT_EQUAL_STRING("usage: exename [-h] [-f FIRST] [-s SECOND] input output\n"
+                             "exename: error: unrecognized arguments: --frist, maybe you meant '--first'?\n",
+                             parser_get_last_err(parser));
+    TEST_ASSERT_EQUAL_STRING("usage: exename [-h] [-f FIRST] [-s SECOND] input output\n"
+                             "exename: error: unrecognized arguments: --frist, maybe you meant '--first'?\n",
+                             parser_get_last_err(parser));
+
+    args[1] = "--error";
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 3, args), "Parse Error");
+    TEST_ASSERT_EQUAL_STRING("usage: exename [-h] [-f FIRST] [-s SECOND] input output\n"
+                             "exename: error: unrecognized arguments: --error\n",
+                             parser_get_last_err(parser));
+
+    args[1] = "-q";
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 3, args), "Parse Error");
+    TEST_ASSERT_EQUAL_STRING("usage: exename [-h] [-f FIRST] [-s SECOND] input output\n"
+                             "exename: error: unrecognized arguments: -q\n",
+                             parser_get_last_err(parser));
+
+    args[1] = "-second";
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 3, args), "Parse Error");
+    TEST_ASSERT_EQUAL_STRING("usage: exename [-h] [-f FIRST] [-s SECOND] input output\n"
+                             "exename: error: unrecognized arguments: -second, maybe you meant '--second'?\n",
+                             parser_get_last_err(parser));
+    parser_free(&parser);
+}
+
+void test_Parser_OptionalArgsSuggestionAfterSetAlt() {
+    parser_t* parser;
+    parser_int_arg_t* count_arg;
+    char* args[] = { "exename", "--cuont" };
+
+    parser_init(&parser);
+    parser_int_add_arg(parser, &count_arg, "--count");
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 2, args), "Parse Error");
+    TEST_ASSERT_NOT_NULL(strstr(parser_get_last_err(parser), "maybe you meant '--count'?\n"));
+
+    parser_int_set_alt(count_arg, "--number");
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 2, args), "Parse Error");
+    TEST_ASSERT_NULL(strstr(parser_get_last_err(parser), "maybe you meant"));
+
+    args[1] = "--nubmer";
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 2, args), "Parse Error");
+    TEST_ASSERT_NOT_NULL(strstr(parser_get_last_err(parser), "maybe you meant '--number'?\n"));
+    parser_free(&parser);
+}
+
+void test_Parser_OptionalArgsSuggestionManyOptions() {
+    parser_t* parser;
+    parser_flag_arg_t* flag_arg;
+    char names[10000][16];
+    char* args[] = { "exename", "--optoin-734" };
+
+    parser_init(&parser);
+    for (int i = 0; i < 10000; ++i) {
+        sprintf(names[i], "--option-%d", i);
+        parser_flag_add_arg(parser, &flag_arg, names[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 2, args), "Parse Error");
+    TEST_ASSERT_NOT_NULL(strstr(parser_get_last_err(parser),
+                                "unrecognized arguments: --optoin-734, maybe you meant '--option-734'?\n"));
+
+    args[1] = "--option-73a";
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 2, args), "Parse Error");
+    TEST_ASSERT_NOT_NULL(strstr(parser_get_last_err(parser),
+                                "unrecognized arguments: --option-73a, maybe you meant "
+                                "'--option-730' or '--option-731' or '--option-732'?\n"));
+    parser_free(&parser);
+}
+
 void test_Parser_HelpArgs() {
     parser_t* parser;
     parser_string_arg_t* input_arg;
@@ -223,6 +306,623 @@ void test_OnlyOptionalParser_WithoutArgs() {
     parser_free(&parser);
 }
 
+void test_Parser_DefaultsAfterParse() {
+    parser_t* parser;
+    parser_int_arg_t* opt_int_arg;
+    parser_string_arg_t* opt_str_arg;
+    char* args[] = { "exename", "--first", "123" };
+
+    init_parser(&parser, NULL, NULL, &opt_int_arg, &opt_str_arg, NULL, true, false);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_OK, parser_parse(parser, 3, args), "Parse Error");
+    parser_int_set_default(opt_int_arg, 7);
+    parser_string_set_default(opt_str_arg, "late");
+    TEST_ASSERT_EQUAL_INT(123, parser_int_get_value(opt_int_arg));
+    TEST_ASSERT_EQUAL_STRING("late", parser_string_get_value(opt_str_arg));
+    parser_free(&parser);
+}
+
+void test_Parser_IntArgsError() {
+    parser_t* parser;
+    parser_int_arg_t* opt_int_arg;
+    char* args[] = { "exename", "-f", "12abc" };
+
+    init_parser(&parser, NULL, NULL, &opt_int_arg, NULL, NULL, true, false);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 3, args), "Parse Error");
+    TEST_ASSERT_EQUAL_STRING("usage: exename [-h] [-f FIRST]\n"
+                             "exename: error: argument -f/--first: invalid int value: '12abc'\n",
+                             parser->last_err);
+    parser_free(&parser);
+}
+
+#ifdef ARGPARSE_LAZY
+void test_LazyParser_ConvertOnAccess() {
+    parser_t* parser;
+    parser_int_arg_t* opt_int_arg;
+    parser_string_arg_t* opt_str_arg;
+    int value;
+    char* args[] = { "exename", "--first", "abc", "--first", "42", "-s", "value" };
+
+    init_parser(&parser, NULL, NULL, &opt_int_arg, &opt_str_arg, NULL, true, false);
+    parser_set_lazy(parser, true);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_OK, parser_parse(parser, 7, args), "Parse Error");
+    TEST_ASSERT_TRUE(opt_int_arg->base.is_pending);
+    TEST_ASSERT_EQUAL_STRING("42", opt_int_arg->base.raw_value);
+    TEST_ASSERT_EQUAL_INT(42, parser_int_get_value(opt_int_arg));
+    TEST_ASSERT_FALSE(opt_int_arg->base.is_pending);
+    TEST_ASSERT_EQUAL_STRING("value", parser_string_get_value(opt_str_arg));
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_OK, parser_int_get_checked(parser, opt_int_arg, &value));
+    TEST_ASSERT_EQUAL_INT(42, value);
+    parser_free(&parser);
+}
+
+void test_LazyParser_CheckedError() {
+    parser_t* parser;
+    parser_int_arg_t* opt_int_arg;
+    int value;
+    char* args[] = { "exename", "--first", "abc" };
+
+    init_parser(&parser, NULL, NULL, &opt_int_arg, NULL, NULL, true, false);
+    parser_set_lazy(parser, true);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_OK, parser_parse(parser, 3, args), "Parse Error");
+    TEST_ASSERT_EQUAL_INT(1, parser_int_get_value(opt_int_arg));
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_ERROR, parser_int_get_checked(parser, opt_int_arg, &value));
+    TEST_ASSERT_EQUAL_INT(1, value);
+    TEST_ASSERT_EQUAL_STRING("usage: exename [-h] [-f FIRST]\n"
+                             "exename: error: argument -f/--first: invalid int value: 'abc'\n",
+                             parser->last_err);
+    parser_int_set_default(opt_int_arg, 5);
+    TEST_ASSERT_EQUAL_INT(5, parser_int_get_value(opt_int_arg));
+    parser_free(&parser);
+}
+
+void test_LazyParser_DefaultAfterParse() {
+    parser_t* parser;
+    parser_int_arg_t* opt_int_arg;
+    parser_choice_arg_t* mode_arg;
+    char const * modes[] = { "fast", "safe", "paranoid" };
+    char* args[] = { "exename", "--mode", "bogus", "--first", "7" };
+
+    init_parser(&parser, NULL, NULL, &opt_int_arg, NULL, NULL, true, false);
+    parser_choice_add_arg(parser, &mode_arg, "--mode", modes, 3);
+    parser_choice_set_default(mode_arg, 0);
+    parser_set_lazy(parser, true);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_OK, parser_parse(parser, 5, args), "Parse Error");
+    parser_choice_set_default(mode_arg, 2);
+    parser_int_set_default(opt_int_arg, 3);
+    TEST_ASSERT_EQUAL_INT(2, parser_choice_get_value(mode_arg));
+    TEST_ASSERT_EQUAL_INT(7, parser_int_get_value(opt_int_arg));
+    parser_choice_set_default(mode_arg, 1);
+    parser_int_set_default(opt_int_arg, 4);
+    TEST_ASSERT_EQUAL_INT(1, parser_choice_get_value(mode_arg));
+    TEST_ASSERT_EQUAL_INT(7, parser_int_get_value(opt_int_arg));
+    parser_free(&parser);
+}
+#endif
+
+void test_Parser_PathArgs() {
+    parser_t* parser;
+    parser_path_arg_t* input_arg;
+    parser_path_arg_t* output_arg;
+    parser_path_arg_t* dir_arg;
+    char* args[] = { "exename", "--dir", "/", "-", "/" };
+
+    parser_init(&parser);
+    parser_path_add_arg(parser, &input_arg, "input", PARSER_PATH_MUST_EXIST | PARSER_PATH_READABLE);
+    parser_path_add_arg(parser, &output_arg, "output", PARSER_PATH_MUST_EXIST);
+    parser_path_add_arg(parser, &dir_arg, "--dir", PARSER_PATH_DIR);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_OK, parser_parse(parser, 5, args), "Parse Error");
+    TEST_ASSERT_EQUAL_STRING("-", parser_path_get_value(input_arg));
+    TEST_ASSERT_EQUAL_STRING("/", parser_path_get_value(output_arg));
+    TEST_ASSERT_TRUE(parser_path_is_filled(dir_arg));
+    parser_free(&parser);
+}
+
+void test_Parser_PathArgsWritable() {
+    parser_t* parser;
+    parser_path_arg_t* output_arg;
+    char* args[] = { "exename", "/tmp/argparse-missing-output" };
+
+    parser_init(&parser);
+    parser_path_add_arg(parser, &output_arg, "output", PARSER_PATH_WRITABLE);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_OK, parser_parse(parser, 2, args), "Parse Error");
+
+    args[1] = "/argparse-missing-dir/output";
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 2, args), "Parse Error");
+    TEST_ASSERT_EQUAL_STRING("usage: exename [-h] output\n"
+                             "exename: error: argument output: path is not writable: '/argparse-missing-dir/output'\n",
+                             parser->last_err);
+    parser_free(&parser);
+}
+
+parser_result_t stop_action(parser_t* parser, void* arg, void* context) {
+    return PARSER_RESULT_STOP;
+}
+
+void test_Parser_PathArgsError() {
+    parser_t* parser;
+    parser_path_arg_t* input_arg;
+    parser_path_arg_t* output_arg;
+    char* args[] = { "exename", "/argparse-missing-input", "/" };
+
+    parser_init(&parser);
+    parser_path_add_arg(parser, &input_arg, "input", PARSER_PATH_MUST_EXIST);
+    parser_path_add_arg(parser, &output_arg, "output", PARSER_PATH_FILE);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 3, args), "Parse Error");
+    TEST_ASSERT_EQUAL_STRING("usage: exename [-h] input output\n"
+                             "exename: error: argument input: path does not exist: '/argparse-missing-input'\n",
+                             parser->last_err);
+
+    args[1] = "/";
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 3, args), "Parse Error");
+    TEST_ASSERT_EQUAL_STRING("usage: exename [-h] input output\n"
+                             "exename: error: argument output: not a file: '/'\n",
+                             parser->last_err);
+    parser_free(&parser);
+
+    parser_init(&parser);
+    parser_path_add_arg(parser, &input_arg, "input", PARSER_PATH_MUST_EXIST);
+    parser_path_add_arg(parser, &output_arg, "output", PARSER_PATH_FILE);
+    parser_path_set_action(input_arg, stop_action, NULL);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_STOP, parser_parse(parser, 3, args), "Parse Error");
+    TEST_ASSERT_FALSE(parser_path_is_filled(output_arg));
+    args[1] = "/argparse-missing-input";
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 3, args), "Parse Error");
+    TEST_ASSERT_EQUAL_STRING("usage: exename [-h] input output\n"
+                             "exename: error: argument input: path does not exist: '/argparse-missing-input'\n",
+                             parser->last_err);
+    parser_free(&parser);
+}
+
+void test_Parser_PathArgsBatch() {
+    parser_t* parser;
+    parser_path_arg_t* path_args[64];
+    char names[64][8];
+    char* args[65];
+
+    parser_init(&parser);
+    args[0] = "exename";
+    for (int i = 0; i < 64; ++i) {
+        sprintf(names[i], "p%d", i);
+        parser_path_add_arg(parser, &path_args[i], names[i], PARSER_PATH_DIR);
+        args[i + 1] = "/";
+    }
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_OK, parser_parse(parser, 65, args), "Parse Error");
+
+    args[50] = "/argparse-missing-dir";
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 65, args), "Parse Error");
+    TEST_ASSERT_EQUAL_INT(0, path_args[48]->status);
+    TEST_ASSERT_TRUE(path_args[49]->status != 0);
+    parser_free(&parser);
+}
+
+void build_image(void** image, size_t* size) {
+    parser_t* parser;
+    parser_string_arg_t* input_arg;
+    parser_string_arg_t* output_arg;
+    parser_int_arg_t* opt_int_arg;
+    parser_string_arg_t* opt_str_arg;
+    parser_choice_arg_t* mode_arg;
+    parser_path_arg_t* dir_arg;
+    char const * modes[] = { "fast", "safe", "paranoid" };
+    void* built;
+
+    init_parser(&parser, &input_arg, &output_arg, &opt_int_arg, &opt_str_arg, NULL, true, false);
+    parser_choice_add_arg(parser, &mode_arg, "--mode", modes, 3);
+    parser_choice_set_default(mode_arg, 2);
+    parser_path_add_arg(parser, &dir_arg, "--dir", PARSER_PATH_DIR);
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_OK, parser_image_build(parser, &built, size));
+    parser_free(&parser);
+
+    // Move the image away from where it was built, as mapping it would.
+    *image = malloc(*size);
+    memcpy(*image, built, *size);
+    free(built);
+}
+
+void test_ImageParser_Args() {
+    parser_t* parser;
+    void* image;
+    size_t size;
+    char* args[] = { "exename", "-f", "123", "input_filename", "--mode", "safe", "output_filename", "--dir", "/" };
+
+    build_image(&image, &size);
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_OK, parser_image_attach(&parser, image, size));
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_OK, parser_parse(parser, 9, args), "Parse Error");
+    TEST_ASSERT_EQUAL_STRING("input_filename", parser_string_get_value((parser_string_arg_t*)parser_find_arg(parser, "input")));
+    TEST_ASSERT_EQUAL_STRING("output_filename", parser_string_get_value((parser_string_arg_t*)parser_find_arg(parser, "output")));
+    TEST_ASSERT_EQUAL_INT(123, parser_int_get_value((parser_int_arg_t*)parser_find_arg(parser, "--first")));
+    TEST_ASSERT_EQUAL_STRING("default", parser_string_get_value((parser_string_arg_t*)parser_find_arg(parser, "-s")));
+    TEST_ASSERT_EQUAL_INT(1, parser_choice_get_value((parser_choice_arg_t*)parser_find_arg(parser, "--mode")));
+    TEST_ASSERT_TRUE(parser_path_is_filled((parser_path_arg_t*)parser_find_arg(parser, "--dir")));
+    TEST_ASSERT_NULL(parser_find_arg(parser, "--missing"));
+
+    parser_int_set_alt((parser_int_arg_t*)parser_find_arg(parser, "--first"), "--renamed");
+    TEST_ASSERT_NOT_NULL(parser_find_arg(parser, "--first"));
+    TEST_ASSERT_NULL(parser_find_arg(parser, "--renamed"));
+    parser_free(&parser);
+    free(image);
+}
+
+void test_ImageParser_Errors() {
+    parser_t* parser;
+    parser_int_arg_t* opt_int_arg;
+    void* image;
+    size_t size;
+    char* args[] = { "exename", "--help" };
+
+    build_image(&image, &size);
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_ERROR, parser_image_attach(&parser, image, size - 1));
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_OK, parser_image_attach(&parser, image, size));
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_ERROR, parser_int_add_arg(parser, &opt_int_arg, "--third"));
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_HELP, parser_parse(parser, 2, args), "Parse Error");
+    TEST_ASSERT_EQUAL_STRING("usage: exename [-h] [-f FIRST] [-s SECOND] [--mode MODE] [--dir DIR] input output\n"
+                             "\n"
+                             "positional arguments:\n"
+                             "  input                 input file\n"
+                             "  output                output file\n"
+                             "\n"
+                             "optional arguments:\n"
+                             "  -h, --help            show this help message and exit\n"
+                             "  -f FIRST, --first FIRST\n"
+                             "                        first int optional argument\n"
+                             "  -s SECOND, --second SECOND\n"
+                             "                        second string optional argument\n"
+                             "  --mode MODE           \n"
+                             "  --dir DIR             \n"
+                             "\n",
+                             parser->last_err);
+
+    args[1] = "--mdoe";
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 2, args), "Parse Error");
+    TEST_ASSERT_NOT_NULL(strstr(parser_get_last_err(parser), "maybe you meant '--mode'?\n"));
+    parser_free(&parser);
+
+    char* shifted = (char*)malloc(size + 8);
+    memcpy(shifted + 1, image, size);
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_ERROR, parser_image_attach(&parser, shifted + 1, size));
+    free(shifted);
+
+    memcpy(image, "XXXX", 4);
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_ERROR, parser_image_attach(&parser, image, size));
+    free(image);
+}
+
+char* find_image_string(void* image, size_t size, char const * value) {
+    size_t length = strlen(value) + 1;
+    for (size_t i = 0; i + length <= size; ++i) {
+        if (memcmp((char*)image + i, value, length) == 0) {
+            return (char*)image + i;
+        }
+    }
+    return NULL;
+}
+
+void test_ImageParser_Corrupted() {
+    parser_t* parser;
+    void* image;
+    void* corrupted;
+    size_t size;
+    unsigned int seed = 1;
+    char* parse_args[] = { "exename", "-f", "1", "input_filename", "--mode", "safe", "output_filename" };
+    char* error_args[] = { "exename", "--mdoe" };
+    char* help_args[] = { "exename", "-h" };
+
+    build_image(&image, &size);
+    corrupted = malloc(size);
+
+    memcpy(corrupted, image, size);
+    strcpy(find_image_string(corrupted, size, "--dir"), "--");
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_ERROR, parser_image_attach(&parser, corrupted, size));
+    memcpy(corrupted, image, size);
+    strcpy(find_image_string(corrupted, size, "-f"), "f");
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_ERROR, parser_image_attach(&parser, corrupted, size));
+    memcpy(corrupted, image, size);
+    find_image_string(corrupted, size, "input")[0] = '-';
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_ERROR, parser_image_attach(&parser, corrupted, size));
+
+    // Whatever attaches has to survive parsing and rendering.
+    for (int i = 0; i < 5000; ++i) {
+        memcpy(corrupted, image, size);
+        seed = seed * 1103515245u + 12345u;
+        for (unsigned int flips = (seed >> 16) % 4 + 1; flips > 0; --flips) {
+            seed = seed * 1103515245u + 12345u;
+            ((unsigned char*)corrupted)[(seed >> 8) % size] ^= (unsigned char)(1u << ((seed >> 4) % 8));
+        }
+
+        if (parser_image_attach(&parser, corrupted, size) == PARSER_RESULT_OK) {
+            parser_parse(parser, 7, parse_args);
+            parser_get_last_err(parser);
+            parser_parse(parser, 2, error_args);
+            parser_get_last_err(parser);
+            parser_parse(parser, 2, help_args);
+            parser_free(&parser);
+        }
+    }
+
+    free(corrupted);
+    free(image);
+}
+
+typedef struct action_log_t {
+    int calls;
+    char const * values[4];
+    int stop_after;
+} action_log_t;
+
+parser_result_t log_string_action(parser_t* parser, void* arg, void* context) {
+    action_log_t* log = (action_log_t*)context;
+    log->values[log->calls++] = parser_string_get_value((parser_string_arg_t*)arg);
+    return log->calls == log->stop_after ? PARSER_RESULT_STOP : PARSER_RESULT_OK;
+}
+
+parser_result_t log_flag_action(parser_t* parser, void* arg, void* context) {
+    action_log_t* log = (action_log_t*)context;
+    log->values[log->calls++] = "flag";
+    return PARSER_RESULT_OK;
+}
+
+parser_result_t reject_action(parser_t* parser, void* arg, void* context) {
+    if (context != NULL) {
+        parser_set_arg_error(parser, arg, (char const *)context);
+    }
+    return PARSER_RESULT_ERROR;
+}
+
+void test_Parser_Actions() {
+    parser_t* parser;
+    parser_string_arg_t* input_arg;
+    parser_string_arg_t* output_arg;
+    parser_flag_arg_t* opt_flag_arg;
+    action_log_t log = { 0, { NULL }, -1 };
+    char* args[] = { "exename", "input_filename", "--mark", "output_filename" };
+
+    init_parser(&parser, &input_arg, &output_arg, NULL, NULL, &opt_flag_arg, true, false);
+    parser_string_set_action(input_arg, log_string_action, &log);
+    parser_string_set_action(output_arg, log_string_action, &log);
+    parser_flag_set_action(opt_flag_arg, log_flag_action, &log);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_OK, parser_parse(parser, 4, args), "Parse Error");
+    TEST_ASSERT_EQUAL_INT(3, log.calls);
+    TEST_ASSERT_EQUAL_STRING("input_filename", log.values[0]);
+    TEST_ASSERT_EQUAL_STRING("flag", log.values[1]);
+    TEST_ASSERT_EQUAL_STRING("output_filename", log.values[2]);
+    parser_free(&parser);
+}
+
+void test_Parser_ActionsStop() {
+    parser_t* parser;
+    parser_string_arg_t* input_arg;
+    parser_string_arg_t* output_arg;
+    action_log_t log = { 0, { NULL }, 1 };
+    char* args[] = { "exename", "input_filename", "--error" };
+
+    init_parser(&parser, &input_arg, &output_arg, NULL, NULL, NULL, true, false);
+    parser_string_set_action(input_arg, log_string_action, &log);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_STOP, parser_parse(parser, 3, args), "Parse Error");
+    TEST_ASSERT_EQUAL_INT(1, log.calls);
+    TEST_ASSERT_TRUE(parser_string_is_filled(input_arg));
+    TEST_ASSERT_FALSE(parser_string_is_filled(output_arg));
+    parser_free(&parser);
+}
+
+void test_Parser_ActionsError() {
+    parser_t* parser;
+    parser_string_arg_t* input_arg;
+    parser_string_arg_t* output_arg;
+    parser_int_arg_t* opt_int_arg;
+    char message[] = "no such file";
+    char* args[] = { "exename", "input_filename", "-f", "12" };
+
+    init_parser(&parser, &input_arg, &output_arg, &opt_int_arg, NULL, NULL, true, false);
+    parser_string_set_action(input_arg, reject_action, message);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 4, args), "Parse Error");
+    TEST_ASSERT_EQUAL_STRING("usage: exename [-h] [-f FIRST] input output\n"
+                             "exename: error: argument input: no such file\n",
+                             parser_get_last_err(parser));
+    parser_free(&parser);
+
+    init_parser(&parser, &input_arg, &output_arg, &opt_int_arg, NULL, NULL, true, false);
+    parser_int_set_action(opt_int_arg, reject_action, NULL);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 4, args), "Parse Error");
+    TEST_ASSERT_EQUAL_STRING("usage: exename [-h] [-f FIRST] input output\n"
+                             "exename: error: argument -f/--first: invalid value: '12'\n",
+                             parser_get_last_err(parser));
+    parser_free(&parser);
+}
+
+void test_Parser_ChoiceArgs() {
+    parser_t* parser;
+    parser_string_arg_t* input_arg;
+    parser_choice_arg_t* mode_arg;
+    char const * modes[] = { "fast", "safe", "paranoid" };
+    char* args[] = { "exename", "input_filename", "--mode", "safe" };
+
+    init_parser(&parser, &input_arg, NULL, NULL, NULL, NULL, false, false);
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_OK, parser_choice_add_arg(parser, &mode_arg, "--mode", modes, 3));
+    parser_choice_set_alt(mode_arg, "-m");
+    parser_choice_set_default(mode_arg, 0);
+    TEST_ASSERT_EQUAL_INT(0, parser_choice_get_value(mode_arg));
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_OK, parser_parse(parser, 4, args), "Parse Error");
+    TEST_ASSERT_TRUE(parser_choice_is_filled(mode_arg));
+    TEST_ASSERT_EQUAL_INT(1, parser_choice_get_value(mode_arg));
+    parser_free(&parser);
+}
+
+void test_Parser_ChoiceArgsError() {
+    parser_t* parser;
+    parser_string_arg_t* input_arg;
+    parser_choice_arg_t* mode_arg;
+    char const * modes[] = { "fast", "safe" };
+    char* args[] = { "exename", "-m", "slow", "input_filename" };
+
+    init_parser(&parser, &input_arg, NULL, NULL, NULL, NULL, false, false);
+    parser_choice_add_arg(parser, &mode_arg, "--mode", modes, 2);
+    parser_choice_set_alt(mode_arg, "-m");
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 4, args), "Parse Error");
+    TEST_ASSERT_EQUAL_STRING("usage: exename [-h] [-m MODE] input\n"
+                             "exename: error: argument -m/--mode: invalid choice: 'slow' (choose from 'fast', 'safe')\n",
+                             parser->last_err);
+    parser_free(&parser);
+}
+
+void test_Parser_ChoiceArgsLargeVocabulary() {
+    parser_t* parser;
+    parser_choice_arg_t* word_arg;
+    char names[500][8];
+    char const * choices[500];
+    char const * duplicates[] = { "same", "other", "same" };
+
+    for (int i = 0; i < 500; ++i) {
+        sprintf(names[i], "w%d", i * 7);
+        choices[i] = names[i];
+    }
+
+    parser_init(&parser);
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_OK, parser_choice_add_arg(parser, &word_arg, "word", choices, 500));
+    for (int i = 0; i < 500; ++i) {
+        TEST_ASSERT_EQUAL_INT(i, parser_choice_lookup(word_arg, choices[i]));
+    }
+    TEST_ASSERT_EQUAL_INT(-1, parser_choice_lookup(word_arg, "w1"));
+    TEST_ASSERT_EQUAL_INT(-1, parser_choice_lookup(word_arg, ""));
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_ERROR, parser_choice_add_arg(parser, &word_arg, "dup", duplicates, 3));
+    parser_free(&parser);
+}
+
+void test_Parser_ChoiceArgsPowerOfTwo() {
+    parser_t* parser;
+    parser_choice_arg_t* pair_arg;
+    parser_choice_arg_t* switch_arg;
+    parser_choice_arg_t* level_arg;
+    char const * pair[] = { "a", "c" };
+    char const * switches[] = { "on", "off" };
+    char const * levels[] = { "debug", "info", "warn", "error" };
+    char* args[] = { "exename", "--pair", "c", "--switch", "off", "--level", "warn" };
+
+    parser_init(&parser);
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_OK, parser_choice_add_arg(parser, &pair_arg, "--pair", pair, 2));
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_OK, parser_choice_add_arg(parser, &switch_arg, "--switch", switches, 2));
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_OK, parser_choice_add_arg(parser, &level_arg, "--level", levels, 4));
+    for (int i = 0; i < 4; ++i) {
+        TEST_ASSERT_EQUAL_INT(i, parser_choice_lookup(level_arg, levels[i]));
+    }
+    TEST_ASSERT_EQUAL_INT(0, parser_choice_lookup(switch_arg, "on"));
+    TEST_ASSERT_EQUAL_INT(-1, parser_choice_lookup(switch_arg, "of"));
+
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_OK, parser_parse(parser, 7, args), "Parse Error");
+    TEST_ASSERT_EQUAL_INT(1, parser_choice_get_value(pair_arg));
+    TEST_ASSERT_EQUAL_INT(1, parser_choice_get_value(switch_arg));
+    TEST_ASSERT_EQUAL_INT(2, parser_choice_get_value(level_arg));
+    parser_free(&parser);
+}
+
+#ifdef ARGPARSE_STATS
+void test_Parser_Stats() {
+    parser_t* parser;
+    parser_string_arg_t* input_arg;
+    parser_string_arg_t* output_arg;
+    parser_int_arg_t* opt_int_arg;
+    parser_string_arg_t* opt_str_arg;
+    parser_stats_t stats;
+    char* args[] = { "exename", "-f", "123", "--second", "value", "input_filename", "output_filename" };
+
+    init_parser(&parser, &input_arg, &output_arg, &opt_int_arg, &opt_str_arg, NULL, true, false);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_OK, parser_parse(parser, 7, args), "Parse Error");
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_OK, parser_get_stats(parser, &stats));
+    TEST_ASSERT_EQUAL_UINT(6, stats.tokens);
+    TEST_ASSERT_EQUAL_UINT(2, stats.lookups);
+    TEST_ASSERT_EQUAL_UINT(5, stats.lookup_comparisons);
+    TEST_ASSERT_EQUAL_UINT(6, stats.allocations);
+    TEST_ASSERT_EQUAL_UINT(0, stats.last_err_grows);
+    TEST_ASSERT_EQUAL_UINT(PARSER_PHASE_COUNT, stats.current_phase);
+    parser_free(&parser);
+}
+
+void test_Parser_StatsRendering() {
+    parser_t* parser;
+    parser_string_arg_t* input_arg;
+    parser_string_arg_t* output_arg;
+    parser_int_arg_t* opt_int_arg;
+    parser_string_arg_t* opt_str_arg;
+    parser_stats_t stats;
+    char* args[] = { "exename", "--help" };
+
+    init_parser(&parser, &input_arg, &output_arg, &opt_int_arg, &opt_str_arg, NULL, true, false);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_HELP, parser_parse(parser, 2, args), "Parse Error");
+    parser_get_stats(parser, &stats);
+    TEST_ASSERT_EQUAL_UINT(8, stats.allocations);
+    TEST_ASSERT_EQUAL_UINT(1, stats.last_err_grows);
+    TEST_ASSERT_TRUE(stats.phase_ns[PARSER_PHASE_RENDERING] > 0);
+    parser_free(&parser);
+}
+
+void test_Parser_StatsChoiceBuild() {
+    parser_t* parser;
+    parser_choice_arg_t* mode_arg;
+    parser_stats_t before;
+    parser_stats_t after;
+    char const * modes[] = { "fast", "safe", "paranoid" };
+
+    parser_init(&parser);
+    parser_get_stats(parser, &before);
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_OK, parser_choice_add_arg(parser, &mode_arg, "--mode", modes, 3));
+    parser_get_stats(parser, &after);
+    // The arg, its two tables and five scratch arrays of the hash build.
+    TEST_ASSERT_EQUAL_UINT(8, after.allocations - before.allocations);
+    parser_free(&parser);
+}
+
+void test_Parser_StatsSuggestIndex() {
+    parser_t* parser;
+    parser_string_arg_t* input_arg;
+    parser_string_arg_t* output_arg;
+    parser_int_arg_t* opt_int_arg;
+    parser_string_arg_t* opt_str_arg;
+    parser_stats_t before;
+    parser_stats_t after;
+    char* args[] = { "exename", "--frist", "1" };
+
+    init_parser(&parser, &input_arg, &output_arg, &opt_int_arg, &opt_str_arg, NULL, true, false);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(PARSER_RESULT_ERROR, parser_parse(parser, 3, args), "Parse Error");
+    parser_get_stats(parser, &before);
+    parser_get_last_err(parser);
+    parser_get_stats(parser, &after);
+    // Two scratch arrays and the four index arrays, besides any error buffer growth.
+    TEST_ASSERT_EQUAL_UINT(6, (after.allocations - before.allocations) - (after.last_err_grows - before.last_err_grows));
+    parser_free(&parser);
+}
+
+void test_ImageParser_StatsLookups() {
+    parser_t* builder;
+    parser_t* parser;
+    parser_flag_arg_t* flag_arg;
+    parser_stats_t stats;
+    char names[4000][16];
+    void* image;
+    size_t size;
+
+    parser_init(&builder);
+    for (int i = 0; i < 4000; ++i) {
+        sprintf(names[i], "--option-%d", i);
+        parser_flag_add_arg(builder, &flag_arg, names[i]);
+    }
+    parser_get_stats(builder, &stats);
+    unsigned long allocated_bytes = stats.allocated_bytes;
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_OK, parser_image_build(builder, &image, &size));
+    parser_get_stats(builder, &stats);
+    TEST_ASSERT_TRUE(stats.allocated_bytes - allocated_bytes >= size);
+    parser_free(&builder);
+
+    TEST_ASSERT_EQUAL_UINT(PARSER_RESULT_OK, parser_image_attach(&parser, image, size));
+    for (int i = 0; i < 4000; ++i) {
+        TEST_ASSERT_NOT_NULL(parser_find_arg(parser, names[i]));
+    }
+    parser_get_stats(parser, &stats);
+    TEST_ASSERT_EQUAL_UINT(4000, stats.lookups);
+    TEST_ASSERT_TRUE(stats.lookup_comparisons < 2 * 4000);
+    parser_free(&parser);
+    free(image);
+}
+#endif
+
 int main(int argc, char** argv)
 {
     UNITY_BEGIN();
@@ -233,10 +933,43 @@ int main(int argc, char** argv)
     RUN_TEST(test_Parser_DashedArgs);
     RUN_TEST(test_OnlyPositionalParser_OnlyPositionalArgs);
     RUN_TEST(test_OnlyOptionalParser_WithoutArgs);
+    RUN_TEST(test_Parser_DefaultsAfterParse);
+    RUN_TEST(test_Parser_Actions);
+    RUN_TEST(test_Parser_ActionsStop);
+    RUN_TEST(test_Parser_ActionsError);
+    RUN_TEST(test_Parser_ChoiceArgs);
+    RUN_TEST(test_Parser_PathArgs);
+    RUN_TEST(test_Parser_PathArgsBatch);
+    RUN_TEST(test_Parser_PathArgsWritable);
+    RUN_TEST(test_ImageParser_Args);
+    RUN_TEST(test_Parser_ChoiceArgsLargeVocabulary);
+    RUN_TEST(test_Parser_ChoiceArgsPowerOfTwo);
 
     RUN_TEST(test_Parser_PositionalArgsError);
     RUN_TEST(test_Parser_OptionalArgsError);
+    RUN_TEST(test_Parser_OptionalArgsSuggestion);
+    RUN_TEST(test_Parser_OptionalArgsSuggestionAfterSetAlt);
+    RUN_TEST(test_Parser_OptionalArgsSuggestionManyOptions);
+    RUN_TEST(test_Parser_ChoiceArgsError);
+    RUN_TEST(test_Parser_IntArgsError);
+    RUN_TEST(test_Parser_PathArgsError);
+    RUN_TEST(test_ImageParser_Errors);
+    RUN_TEST(test_ImageParser_Corrupted);
     RUN_TEST(test_Parser_HelpArgs);
 
+#ifdef ARGPARSE_LAZY
+    RUN_TEST(test_LazyParser_ConvertOnAccess);
+    RUN_TEST(test_LazyParser_CheckedError);
+    RUN_TEST(test_LazyParser_DefaultAfterParse);
+#endif
+
+#ifdef ARGPARSE_STATS
+    RUN_TEST(test_Parser_Stats);
+    RUN_TEST(test_Parser_StatsRendering);
+    RUN_TEST(test_Parser_StatsChoiceBuild);
+    RUN_TEST(test_Parser_StatsSuggestIndex);
+    RUN_TEST(test_ImageParser_StatsLookups);
+#endif
+
     return UNITY_END();
 }